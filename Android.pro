@@ -1,4 +1,4 @@
-QT += core gui bluetooth printsupport sql
+QT += core gui bluetooth network printsupport sql
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -9,19 +9,46 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    appsettings.cpp \
     bluetooth.cpp \
+    channels.cpp \
+    commandqueue.cpp \
     databasemanager.cpp \
+    devicesession.cpp \
+    framedecoder.cpp \
     login.cpp \
     main.cpp \
     mainwindow.cpp \
-    qcustomplot.cpp
+    qcustomplot.cpp \
+    segmentstore.cpp \
+    servicecache.cpp \
+    streamcapture.cpp \
+    streamwriter.cpp \
+    telemetry.cpp \
+    transport.cpp
 
 HEADERS += \
+    appsettings.h \
     bluetooth.h \
+    channels.h \
+    commandqueue.h \
     databasemanager.h \
+    devicesession.h \
+    framedecoder.h \
+    framelayout.h \
+    ingeststats.h \
     login.h \
     mainwindow.h \
-    qcustomplot.h
+    qcustomplot.h \
+    rollingrange.h \
+    sample.h \
+    segmentstore.h \
+    servicecache.h \
+    spscring.h \
+    streamcapture.h \
+    streamwriter.h \
+    telemetry.h \
+    transport.h
 
 FORMS += \
     login.ui \
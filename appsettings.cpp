@@ -0,0 +1,16 @@
+#include "appsettings.h"
+#include <QStandardPaths>
+#include <QDir>
+
+QString appDataDir()
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(path);
+    return path;
+}
+
+QSettings &appSettings()
+{
+    static QSettings settings(appDataDir() + "/robotcontrol.ini", QSettings::IniFormat);
+    return settings;
+}
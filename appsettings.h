@@ -0,0 +1,13 @@
+#ifndef APPSETTINGS_H
+#define APPSETTINGS_H
+
+#include <QString>
+#include <QSettings>
+
+// 应用数据目录（数据库、配置文件等都存放在这里）
+QString appDataDir();
+
+// 应用配置，保存在数据目录下的 robotcontrol.ini 中（只在 GUI 线程中访问）
+QSettings &appSettings();
+
+#endif // APPSETTINGS_H
@@ -1,5 +1,8 @@
 #include "bluetooth.h"
+#include "servicecache.h"
 #include <QDebug>
+#include <QDateTime>
+#include <QElapsedTimer>
 
 BlueDevice::BlueDevice(QObject *parent)
     : QObject(parent)
@@ -13,17 +16,18 @@ BlueDevice::BlueDevice(QObject *parent)
     connect(discoveryAgent.data(), &QBluetoothDeviceDiscoveryAgent::finished,
             this, &BlueDevice::discoveryFinished);
 
-    // 创建 RFCOMM 经典蓝牙套接字
-    socket.reset(new QBluetoothSocket(QBluetoothServiceInfo::RfcommProtocol, this));
-    connect(socket.data(), &QBluetoothSocket::connected, this, &BlueDevice::socketConnected);
-    connect(socket.data(), &QBluetoothSocket::disconnected, this, &BlueDevice::socketDisconnected);
-    connect(socket.data(), &QBluetoothSocket::readyRead, this, &BlueDevice::readSocketData);
-    connect(socket.data(), &QBluetoothSocket::errorOccurred, this, &BlueDevice::handleSocketError);
+    // 经典蓝牙服务发现：一个代理按队列逐台设备做 SDP
+    serviceDiscoveryAgent.reset(new QBluetoothServiceDiscoveryAgent(this));
+    connect(serviceDiscoveryAgent.data(), &QBluetoothServiceDiscoveryAgent::serviceDiscovered,
+            this, &BlueDevice::serviceDiscoveredClassic);
+    connect(serviceDiscoveryAgent.data(), &QBluetoothServiceDiscoveryAgent::finished,
+            this, &BlueDevice::startNextServiceDiscovery);
 }
 
 BlueDevice::~BlueDevice()
 {
     qDebug() << "销毁蓝牙设备...";
+    capture.close();
 }
 
 void BlueDevice::startDiscovery()
@@ -35,16 +39,31 @@ void BlueDevice::startDiscovery()
 void BlueDevice::deviceDiscoveredSlot(const QBluetoothDeviceInfo &device)
 {
     qDebug() << "发现设备: " << device.name() << " 地址: " << device.address().toString();
-        // 启动经典蓝牙服务发现
-    if (!serviceDiscoveryAgent) {
-        serviceDiscoveryAgent.reset(new QBluetoothServiceDiscoveryAgent(device.address(), this));
-        connect(serviceDiscoveryAgent.data(), &QBluetoothServiceDiscoveryAgent::serviceDiscovered,
-                this, &BlueDevice::serviceDiscoveredClassic);
-        connect(serviceDiscoveryAgent.data(), &QBluetoothServiceDiscoveryAgent::finished,
-                this, &BlueDevice::discoveryFinished);
+    emit deviceDiscovered(device);
+
+    // 已缓存服务的设备不再做 SDP；其余设备排队，每台只做一次经典蓝牙服务发现
+    CachedService cached;
+    if (ServiceCache::instance().lookup(device.address(), &cached)) {
+        return;
+    }
+    if (device.address() != sdpAddress && !sdpQueue.contains(device.address())) {
+        sdpQueue.append(device.address());
+    }
+    startNextServiceDiscovery();
+}
+
+void BlueDevice::startNextServiceDiscovery()
+{
+    if (serviceDiscoveryAgent->isActive()) {
+        return;
+    }
+    if (sdpQueue.isEmpty()) {
+        sdpAddress.clear();
+        return;
     }
+    sdpAddress = sdpQueue.takeFirst();
+    serviceDiscoveryAgent->setRemoteAddress(sdpAddress);
     serviceDiscoveryAgent->start();
-    emit deviceDiscovered(device);
 }
 
 void BlueDevice::discoveryFinished()
@@ -54,73 +73,267 @@ void BlueDevice::discoveryFinished()
 
 void BlueDevice::connectToDevice(const QBluetoothDeviceInfo &device)
 {
-    if (socket->state() != QBluetoothSocket::SocketState::ConnectedState) {
-        socket->connectToService(device.address(), QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::SerialPort));
+    if (transportBusy()) {
+        return;
+    }
+
+    // 搜索和 SDP 会占用射频，连接前先停掉
+    if (discoveryAgent->isActive()) {
+        discoveryAgent->stop();
+    }
+    sdpQueue.clear();
+    if (serviceDiscoveryAgent->isActive()) {
+        serviceDiscoveryAgent->stop();
+    }
+
+    // 命中服务缓存时直接连接已知的 RFCOMM 通道，跳过 SDP
+    CachedService cached;
+    connectFromCache = ServiceCache::instance().lookup(device.address(), &cached);
+    connectingName = device.name();
+    if (connectFromCache) {
+        attachTransport(new RfcommTransport(device.address(), cached.uuid, cached.channel));
+    } else {
+        attachTransport(new RfcommTransport(device.address()));
+    }
+}
+
+void BlueDevice::connectToTransport(const QString &spec)
+{
+    Transport *newTransport = createTransport(spec);
+    if (!newTransport) {
+        // 无法解析的描述串也要报告失败，否则会话会一直停在“连接中”
+        QString message = QString("无法识别的传输层: %1").arg(spec);
+        qDebug() << message;
+        emit connectionFailed(message);
+        return;
+    }
+    attachTransport(newTransport);
+}
+
+void BlueDevice::attachTransport(Transport *newTransport)
+{
+    if (transport) {
+        transport->disconnect(this);
+        transport->close();
+        transport->deleteLater();
+    }
+
+    transport = newTransport;
+    transport->setParent(this);
+    connect(transport, &Transport::connected, this, &BlueDevice::socketConnected);
+    connect(transport, &Transport::disconnected, this, &BlueDevice::socketDisconnected);
+    connect(transport, &Transport::readyRead, this, &BlueDevice::readSocketData);
+    connect(transport, &Transport::bytesWritten, this, [this](qint64 bytes) { commandQueue.onBytesWritten(bytes); });
+    commandQueue.setTransport(transport);
+    connect(transport, &Transport::errorOccurred, this, [this](const QString &message) {
+        qDebug() << "传输层错误: " << message;
+        if (connecting) {
+            connecting = false;
+            emit connectionFailed(message);
+        }
+    });
+    if (auto *rfcomm = qobject_cast<RfcommTransport *>(transport)) {
+        connect(rfcomm, &RfcommTransport::socketErrorOccurred, this, &BlueDevice::handleSocketError);
     }
+
+    qDebug() << "连接传输层: " << transport->description();
+    frameDecoder.reset();
+    connectRequestClock.start();
+    connecting = true;
+    transport->open();
 }
 
 void BlueDevice::serviceDiscoveredClassic(const QBluetoothServiceInfo &service)
 {
     qDebug() << "发现经典蓝牙服务: " << service.serviceName() << " 地址: " << service.device().address().toString();
-    // 选择合适的服务进行连接（例如 SerialPort）
+    // 选择合适的服务进行连接（例如 SerialPort），并记入服务缓存，下次重连跳过 SDP
     if (service.serviceUuid() == QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::SerialPort)) {
-        if (socket->state() != QBluetoothSocket::SocketState::ConnectedState) {
-            socket->connectToService(service.device().address(), service.serviceUuid());
+        CachedService cached;
+        cached.address = service.device().address();
+        cached.name = service.device().name();
+        cached.uuid = service.serviceUuid();
+        cached.channel = quint16(qMax(0, service.serverChannel()));
+        ServiceCache::instance().store(cached);
+
+        if (!transportBusy()) {
+            connectFromCache = false;
+            connectingName = cached.name;
+            attachTransport(new RfcommTransport(cached.address, cached.uuid, cached.channel));
         }
     }
 }
 
 void BlueDevice::socketConnected()
 {
-    qDebug() << "经典蓝牙 (RFCOMM) 连接成功!";
+    qDebug() << transport->description() << "连接成功!";
+    connecting = false;
+    frameDecoder.reset();
+    framesDecoded = 0;
+    lastFrameTime = 0;
+    frameInterval = 0; // 重新连接的可能是另一台设备，帧率重新估计
+    connectClock.start();
+
+    // 连接耗时：从发起连接到连接建立
+    lastConnectLatency = connectRequestClock.elapsed();
+    if (auto *rfcomm = qobject_cast<RfcommTransport *>(transport)) {
+        qDebug() << "连接耗时" << lastConnectLatency << "ms" << (connectFromCache ? "（命中服务缓存）" : "（未命中服务缓存）");
+
+        // 记下实际连上的通道号，下次直接连接
+        CachedService cached;
+        if (!ServiceCache::instance().lookup(rfcomm->address(), &cached) || cached.channel != rfcomm->peerChannel()) {
+            cached.address = rfcomm->address();
+            cached.name = connectingName;
+            cached.uuid = rfcomm->uuid();
+            cached.channel = rfcomm->peerChannel();
+            ServiceCache::instance().store(cached);
+        }
+        ServiceCache::instance().recordConnect(rfcomm->address(), lastConnectLatency);
+    } else {
+        qDebug() << "连接耗时" << lastConnectLatency << "ms";
+    }
+    emit connectLatencyMeasured(lastConnectLatency, connectFromCache);
     emit connectionEstablished();
 }
 
 void BlueDevice::socketDisconnected()
 {
-    qDebug() << "RFCOMM 连接已断开";
+    qDebug() << "连接已断开";
+    lastChannelCount = 0;
+    if (connectClock.isValid()) {
+        qint64 elapsed = qMax<qint64>(1, connectClock.elapsed());
+        qDebug() << "本次连接共解码" << framesDecoded << "帧，用时" << elapsed << "ms，平均"
+                 << framesDecoded * 1000.0 / elapsed << "帧/秒";
+        connectClock.invalidate();
+    }
+    frameDecoder.reset();
+    commandQueue.clear(); // 断线前没发出去的命令已经过时
+    if (commandQueue.sentCount() > 0) {
+        qDebug() << "下发命令" << commandQueue.sentCount() << "条，被覆盖" << commandQueue.supersededCount()
+                 << "条，确认超时" << commandQueue.timedOutCount() << "条，写出耗时平均" << commandQueue.averageLatencyMs() << "ms，最长" << commandQueue.maxLatencyMs() << "ms";
+    }
     emit connectionLost();
 }
 
-void BlueDevice::sendData(const QByteArray &data)
+void BlueDevice::sendData(const QByteArray &data, const QByteArray &kind)
 {
-    if (socket->isOpen()) {
-        socket->write(data);
-        qDebug() << "发送 RFCOMM 数据: " << data;
+    if (transport && transport->isOpen()) {
+        // 进入命令队列，上一条写完后才写下一条；同类的待发命令被新命令替换
+        commandQueue.enqueue(data, kind.isEmpty() ? data.left(1) : kind);
     } else {
-        qDebug() << "RFCOMM 套接字未打开!";
+        qDebug() << "传输层未打开!";
     }
 }
 
 void BlueDevice::readSocketData()
 {
-    QByteArray receivedData = socket->readAll();
-    if (receivedData.length() == 8) {
-        // 定义包尾数据
-        QByteArray expectedTail = QByteArray::fromHex("0000807f");
+    // 内核可能把多帧合并成一次读取，也可能把一帧拆到两次读取中；数据直接读进重组缓冲区统一处理
+    QByteArray &buffer = frameDecoder.receiveBuffer();
+    const int oldSize = buffer.size();
+    transport->readInto(buffer);
+    const int received = buffer.size() - oldSize; // decode 会移除已消费的字节，必须在解码前计算
+    capture.write(buffer.constData() + oldSize, received);
 
-        // 提取接收到数据的后 4 个字节作为包尾
-        QByteArray actualTail = receivedData.right(4);
+    // 一次读取可能包含多帧：最后一帧记为接收时间，之前的帧按估计的帧间隔往前排开；
+    // 间隔不超过距上一次读取最后一帧的时间除以可能的帧数，时间戳在连接内严格递增。
+    // 直接解码进复用的采样数组，稳态下不分配内存
+    const double timestamp = clockTime();
+    double interval = frameInterval;
+    const int expectedFrames = frameDecoder.frameSize() > 0 ? buffer.size() / frameDecoder.frameSize() : 0;
+    if (lastFrameTime > 0 && expectedFrames > 0) {
+        interval = qMin(interval, (timestamp - lastFrameTime) / expectedFrames);
+    }
+    decodedSamples.resize(0);
+    const int frames = frameDecoder.decode(decodedSamples, timestamp, interval);
+    framesDecoded += frames;
+    if (frames > 0) {
+        // 帧间隔取每次读取的平均间隔的滑动平均，设备停发超过 1 秒的空档不计入
+        if (lastFrameTime > 0 && timestamp - lastFrameTime < 1.0) {
+            const double observed = (timestamp - lastFrameTime) / frames;
+            frameInterval = frameInterval > 0 ? frameInterval * 0.875 + observed * 0.125 : observed;
+        }
+        lastFrameTime = timestamp;
+    }
 
-        if (actualTail == expectedTail) {
-            // 提取前 4 个字节的数据
-            QByteArray neededData = receivedData.left(4);
+    // 遥测计数只有本线程写，GUI 线程随时读取
+    counters.frames.fetch_add(quint64(frames), std::memory_order_relaxed);
+    counters.bytes.fetch_add(quint64(received), std::memory_order_relaxed);
+    counters.rejectedFrames.store(frameDecoder.rejectedFrames(), std::memory_order_relaxed);
+    counters.resyncBytes.store(frameDecoder.discardedBytes(), std::memory_order_relaxed);
+    counters.bufferHighWater.store(frameDecoder.bufferHighWater(), std::memory_order_relaxed);
 
-            //qDebug() << "收到有效的 RFCOMM 数据，前四个字节数据为: " << neededData.toHex();
-            emit dataReceived(neededData); // 将提取的数据通过信号发送
-        } else {
-            qDebug() << "包尾不匹配，数据无效";
-        }
+    if (frameDecoder.lastDiscardedBytes() > 0) {
+        emit resyncDiscarded(frameDecoder.lastDiscardedBytes());
+    }
+
+    if (frames == 0) {
+        return;
+    }
+
+    const int channels = frameDecoder.channelCount();
+    if (channels != lastChannelCount) {
+        lastChannelCount = channels;
+        qDebug() << "帧通道数:" << channels;
+        emit channelCountDetected(channels);
+    }
+
+    if (sampleRing) {
+        // 采集线程模式：写入无锁环形缓冲区，由 GUI 线程按帧取出；写满的部分计入溢出计数
+        sampleRing->push(decodedSamples.constData(), decodedSamples.size());
+    } else {
+        emit samplesReceived(decodedSamples);
     }
 }
 
+double BlueDevice::clockTime()
+{
+    static const double epoch = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+    static const QElapsedTimer clock = []() {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return epoch + clock.nsecsElapsed() / 1e9;
+}
+
+IngestStats BlueDevice::ingestStats() const
+{
+    IngestStats stats;
+    stats.frames = counters.frames.load(std::memory_order_relaxed);
+    stats.bytes = counters.bytes.load(std::memory_order_relaxed);
+    stats.rejectedFrames = counters.rejectedFrames.load(std::memory_order_relaxed);
+    stats.resyncBytes = counters.resyncBytes.load(std::memory_order_relaxed);
+    stats.bufferHighWater = counters.bufferHighWater.load(std::memory_order_relaxed);
+    if (sampleRing) {
+        stats.ringOccupancy = sampleRing->size();
+        stats.ringHighWater = sampleRing->highWater();
+        stats.ringOverflow = sampleRing->overflowCount();
+    }
+    return stats;
+}
+
 void BlueDevice::disconnectDevice()
 {
-    if (socket->isOpen()) {
-        socket->close();
+    connecting = false;
+    if (transport) {
+        transport->close();
     }
 }
 
+void BlueDevice::setCaptureFile(const QString &path)
+{
+    if (path.isEmpty()) {
+        capture.close();
+    } else if (capture.open(path)) {
+        qDebug() << "开始抓包:" << path;
+    }
+}
+
+void BlueDevice::setChannelCount(int count)
+{
+    frameDecoder.setChannelCount(count);
+    lastChannelCount = frameDecoder.channelCount();
+}
+
 void BlueDevice::handleSocketError(QBluetoothSocket::SocketError error)
 {
     qDebug() << "Socket error: " << error;
@@ -150,6 +363,18 @@ void BlueDevice::handleSocketError(QBluetoothSocket::SocketError error)
         //qDebug() << "其他错误";
         break;
     }
+
+    // 按缓存的通道号没能连上：通道可能已变，清掉通道号，下次按 UUID 连接（重新做 SDP）
+    auto *rfcomm = qobject_cast<RfcommTransport *>(transport);
+    if (rfcomm && connectFromCache && !connectClock.isValid()) {
+        CachedService cached;
+        if (ServiceCache::instance().lookup(rfcomm->address(), &cached) && cached.channel > 0) {
+            qDebug() << "缓存的 RFCOMM 通道" << cached.channel << "连接失败，清除通道号";
+            cached.channel = 0;
+            ServiceCache::instance().store(cached);
+        }
+        connectFromCache = false;
+    }
     emit socketErrorOccurred(error); // 发送错误信号给主窗口
 }
 
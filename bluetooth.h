@@ -8,6 +8,14 @@
 #include <QBluetoothServiceInfo>
 #include <QBluetoothUuid>
 #include <QScopedPointer>
+#include <atomic>
+#include "framedecoder.h"
+#include "sample.h"
+#include "spscring.h"
+#include "transport.h"
+#include "streamcapture.h"
+#include "commandqueue.h"
+#include "ingeststats.h"
 
 class BlueDevice : public QObject {
     Q_OBJECT
@@ -17,31 +25,78 @@ public:
 
     void startDiscovery(); // 开始搜索蓝牙设备
     void connectToDevice(const QBluetoothDeviceInfo &device); // 连接设备
-    void sendData(const QByteArray &data); // 发送数据
+    void connectToTransport(const QString &spec); // 通过描述串连接任意传输层（伪终端、TCP、文件、模拟器等）
+    void attachTransport(Transport *newTransport); // 接管并打开传输层，替换当前连接
+    void sendData(const QByteArray &data, const QByteArray &kind = QByteArray()); // 发送命令，kind 为命令类别，默认取首字节
     void disconnectDevice(); // 断开连接
+    void setCaptureFile(const QString &path); // 把接收到的原始数据块抓包到文件，传空串停止
+    void setChannelCount(int count); // JustFloat 通道数，0 表示根据包尾间距自动识别
     QBluetoothDeviceDiscoveryAgent* getDiscoveryAgent() const { return discoveryAgent.data(); }
+    void setSampleRing(SpscRing<Sample> *ring) { sampleRing = ring; } // 设置后采样点写入环形缓冲区，不再发 samplesReceived
+    quint64 resyncDiscardedBytes() const { return frameDecoder.discardedBytes(); } // 重同步累计丢弃的字节数
+    IngestStats ingestStats() const; // 采集链路累计计数快照，可在任意线程调用
+    quint64 decodedFrames() const { return framesDecoded; } // 本次连接解码出的帧数
+    qint64 connectLatencyMs() const { return lastConnectLatency; } // 最近一次连接耗时，-1 表示尚未连接过
+    const CommandQueue &commands() const { return commandQueue; } // 下行命令队列及其写出耗时统计，只在本对象所在线程访问
+
+    // 采样时间戳用的时钟（epoch 秒）：第一次调用时对齐系统时间，之后按单调时钟推进，不受系统时间调整影响
+    static double clockTime();
 
 
 signals:
     void deviceDiscovered(const QBluetoothDeviceInfo &device); // 发现设备
     void connectionEstablished(); // 连接成功
     void connectionLost(); // 连接断开
-    void dataReceived(const QByteArray &data); // 接收到数据
+    void connectionFailed(const QString &reason); // 连接尚未建立就失败了
+    void samplesReceived(const SampleBatch &samples); // 一次读取中解码出的全部采样点
     void socketErrorOccurred(QBluetoothSocket::SocketError error); // RFCOMM 错误信号
+    void resyncDiscarded(int bytes); // 重同步时丢弃了 bytes 个字节
+    void channelCountDetected(int count); // 确定了帧中的通道数
+    void connectLatencyMeasured(qint64 ms, bool fromCache); // 发起连接到连接建立的耗时，fromCache 表示命中服务缓存
 
 private slots:
     void deviceDiscoveredSlot(const QBluetoothDeviceInfo &device); // 发现设备
     void discoveryFinished(); // 搜索完成
-    void socketConnected(); // RFCOMM 连接成功
-    void socketDisconnected(); // RFCOMM 连接断开
-    void readSocketData(); // 读取 RFCOMM 数据
+    void socketConnected(); // 传输层连接成功
+    void socketDisconnected(); // 传输层连接断开
+    void readSocketData(); // 读取传输层数据
     void handleSocketError(QBluetoothSocket::SocketError error); // 处理 RFCOMM 错误
     void serviceDiscoveredClassic(const QBluetoothServiceInfo &service); // 发现经典蓝牙服务
+    void startNextServiceDiscovery(); // 对队列中的下一台设备做 SDP
 
 
 private:
     QScopedPointer<QBluetoothDeviceDiscoveryAgent> discoveryAgent; // 使用智能指针管理
-    QScopedPointer<QBluetoothSocket> socket; // RFCOMM 连接
+    Transport *transport = nullptr; // 当前连接（RFCOMM 或本地替身），由本对象持有
     QScopedPointer<QBluetoothServiceDiscoveryAgent> serviceDiscoveryAgent; // 经典蓝牙服务发现
+    QList<QBluetoothAddress> sdpQueue; // 等待做 SDP 的设备
+    QBluetoothAddress sdpAddress; // 正在做 SDP 的设备
+    QElapsedTimer connectRequestClock; // 发起连接时开始计时
+    bool connecting = false; // 已发起连接、尚未建立
+    qint64 lastConnectLatency = -1;
+    bool connectFromCache = false;
+    QString connectingName;
+    FrameDecoder frameDecoder; // 字节流重组缓冲区
+    SampleBatch decodedSamples; // 解码输出，容量在多次读取间复用
+    SpscRing<Sample> *sampleRing = nullptr; // 采集线程模式下与 GUI 线程交接采样点
+    CaptureWriter capture; // 原始数据抓包
+    CommandQueue commandQueue; // 下行命令队列
+    quint64 framesDecoded = 0;
+    int lastChannelCount = 0;
+    double lastFrameTime = 0; // 上一次读取中最后一帧的时间戳，0 表示本次连接还没有收到帧
+    double frameInterval = 0; // 估计的帧间隔（秒）
+    QElapsedTimer connectClock; // 连接建立后开始计时，用于统计吞吐量
+
+    // 采集线程写、其他线程读的遥测计数
+    struct Counters
+    {
+        std::atomic<quint64> frames{0};
+        std::atomic<quint64> bytes{0};
+        std::atomic<quint64> rejectedFrames{0};
+        std::atomic<quint64> resyncBytes{0};
+        std::atomic<int> bufferHighWater{0};
+    } counters;
+
+    bool transportBusy() const { return transport && (transport->isOpen() || transport->isConnecting()); }
 };
 
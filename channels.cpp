@@ -0,0 +1,30 @@
+#include "channels.h"
+#include "appsettings.h"
+
+ChannelInfo channelInfo(int index)
+{
+    static const QStringList defaultNames = {"weight", "impedance", "bodyfat"};
+    static const QVector<QColor> palette = {Qt::blue, Qt::red, Qt::darkGreen, Qt::magenta,
+                                            Qt::darkCyan, Qt::darkYellow, Qt::darkGray, Qt::black};
+
+    QStringList names = appSettings().value("ingest/channelNames", defaultNames).toStringList();
+    QString name = index < names.size() ? names.at(index).trimmed() : QString("ch%1").arg(index);
+
+    ChannelInfo info;
+    info.name = name;
+    info.color = palette.at(index % palette.size());
+    if (name == "weight") {
+        info.type = ChannelType::Weight;
+        info.label = "体重 (kg)";
+    } else if (name == "impedance") {
+        info.type = ChannelType::Impedance;
+        info.label = "阻抗 (Ω)";
+    } else if (name == "bodyfat") {
+        info.type = ChannelType::BodyFat;
+        info.label = "体脂率";
+    } else {
+        info.type = ChannelType::Generic;
+        info.label = name;
+    }
+    return info;
+}
@@ -0,0 +1,28 @@
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <QString>
+#include <QVector>
+#include <QColor>
+
+// JustFloat 帧中各通道的含义
+enum class ChannelType {
+    Weight,     // 体重 kg
+    Impedance,  // 阻抗 Ω
+    BodyFat,    // 体脂率
+    Generic     // 未知通道
+};
+
+struct ChannelInfo
+{
+    ChannelType type;
+    QString name;   // 存储序列名，例如 "weight"
+    QString label;  // 图例显示名
+    QColor color;
+};
+
+// 第 index 个通道的描述，通道名取自配置 ingest/channelNames（逗号分隔），
+// 默认依次为 weight, impedance, bodyfat，其余为 ch<index>
+ChannelInfo channelInfo(int index);
+
+#endif // CHANNELS_H
@@ -0,0 +1,121 @@
+#include "commandqueue.h"
+#include "transport.h"
+#include <QDebug>
+
+CommandQueue::CommandQueue(int capacity)
+    : m_capacity(qMax(1, capacity))
+{
+    m_clock.start();
+}
+
+void CommandQueue::setTransport(Transport *transport)
+{
+    m_transport = transport;
+    clear();
+
+    // 超时定时器作为传输层的子对象创建：CommandQueue 本身不是 QObject，不会随 BlueDevice 移到采集线程，
+    // 定时器必须属于传输层所在的线程；旧的定时器随旧的传输层一起销毁
+    m_writeTimer = nullptr;
+    if (transport) {
+        m_writeTimer = new QTimer(transport);
+        m_writeTimer->setSingleShot(true);
+        QObject::connect(m_writeTimer, &QTimer::timeout, transport, [this]() { onWriteTimeout(); });
+    }
+}
+
+void CommandQueue::clear()
+{
+    m_queue.clear();
+    m_inFlight = false;
+    m_bytesWritten = 0; // 断线或切换传输层后，之前写入的字节不会再确认
+    m_bytesConfirmed = 0;
+    if (m_writeTimer) {
+        m_writeTimer->stop();
+    }
+}
+
+void CommandQueue::enqueue(const QByteArray &data, const QByteArray &kind)
+{
+    // 同类命令尚未发出时直接替换，保留原来的排队位置
+    for (Command &command : m_queue) {
+        if (command.kind == kind) {
+            command.data = data;
+            command.enqueuedNs = m_clock.nsecsElapsed();
+            ++m_superseded;
+            writeNext();
+            return;
+        }
+    }
+
+    if (m_queue.size() >= m_capacity) {
+        m_queue.removeFirst();
+        ++m_dropped;
+        qDebug() << "命令队列已满，丢弃最旧的命令";
+    }
+    m_queue.append(Command{data, kind, m_clock.nsecsElapsed()});
+    writeNext();
+}
+
+void CommandQueue::onBytesWritten(qint64 bytes)
+{
+    // 确认按写入顺序到达：超时放弃的命令剩下的字节先确认，当前命令的字节都确认后才算写完
+    m_bytesConfirmed = qMin(m_bytesConfirmed + bytes, m_bytesWritten);
+    if (m_inFlight && m_bytesConfirmed >= m_inFlightEnd) {
+        finishInFlight();
+        writeNext();
+    }
+}
+
+void CommandQueue::writeNext()
+{
+    while (!m_inFlight && !m_queue.isEmpty() && m_transport && m_transport->isOpen()) {
+        Command command = m_queue.takeFirst();
+        qint64 written = m_transport->write(command.data);
+        if (written < 0) {
+            // 这一条写不进去就丢弃，接着发后面的命令，队列不会停住
+            qDebug() << "命令写入失败，丢弃:" << m_transport->description();
+            ++m_dropped;
+            continue;
+        }
+
+        m_inFlight = true;
+        m_inFlightEnqueuedNs = command.enqueuedNs;
+        m_bytesWritten += written;
+        m_inFlightEnd = m_bytesWritten;
+        if (!m_transport->reportsBytesWritten() || m_bytesConfirmed >= m_inFlightEnd) {
+            // 不报告写出进度的后端（文件、回放）写入即视为完成
+            m_bytesConfirmed = m_bytesWritten;
+            finishInFlight();
+            continue;
+        }
+        if (m_writeTimer) {
+            m_writeTimer->start(m_writeTimeoutMs);
+        }
+    }
+}
+
+void CommandQueue::onWriteTimeout()
+{
+    if (!m_inFlight) {
+        return;
+    }
+    // 传输层接受了写入却一直没有确认，不再等它，后面的命令照常发出；
+    // 它剩下的字节仍计在未确认的字节里，迟到的确认先抵扣这部分
+    qDebug() << "命令写出超过" << m_writeTimeoutMs << "ms 未确认，剩余" << m_inFlightEnd - m_bytesConfirmed << "字节，继续发送下一条";
+    m_inFlight = false;
+    ++m_timedOut;
+    writeNext();
+}
+
+void CommandQueue::finishInFlight()
+{
+    m_inFlight = false;
+    if (m_writeTimer) {
+        m_writeTimer->stop();
+    }
+    qint64 latencyUs = (m_clock.nsecsElapsed() - m_inFlightEnqueuedNs) / 1000;
+    m_lastLatencyUs = latencyUs;
+    m_maxLatencyUs = qMax(m_maxLatencyUs, latencyUs);
+    m_totalLatencyUs += latencyUs;
+    ++m_sent;
+}
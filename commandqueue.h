@@ -0,0 +1,75 @@
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+
+class Transport;
+
+// 下行命令队列：同一时刻只有一条命令写在传输层里，收到 bytesWritten 确认写完后再写下一条，
+// 避免按键连发时命令堆在套接字缓冲区里迟迟才送达。
+// 同类命令只保留最新的一条（例如方向命令，新的覆盖尚未发出的旧的），队列有上限，写满时丢弃最旧的命令。
+// 写出的命令超过 writeTimeoutMs 仍未确认（短写、链路卡住）时放弃等待，继续发下一条。
+// 传输层按写入顺序确认字节，迟到的确认先抵扣被放弃的命令剩下的字节，不会算到后面的命令上
+class CommandQueue
+{
+public:
+    explicit CommandQueue(int capacity = 16);
+
+    void setTransport(Transport *transport); // 切换传输层时清空队列
+    void enqueue(const QByteArray &data, const QByteArray &kind); // kind 相同的待发命令会被新命令替换
+    void onBytesWritten(qint64 bytes); // 传输层的 bytesWritten 信号
+    void clear(); // 连接断开时丢弃未发出的命令
+    void setWriteTimeout(int ms) { m_writeTimeoutMs = qMax(1, ms); }
+
+    int pending() const { return m_queue.size(); }
+    bool isBusy() const { return m_inFlight; } // 有命令已写入、尚未确认写完
+
+    // 统计：命令从入队到写完（bytesWritten 确认）的耗时
+    quint64 sentCount() const { return m_sent; }
+    quint64 supersededCount() const { return m_superseded; }
+    quint64 droppedCount() const { return m_dropped; } // 队列满或写入失败而丢弃的命令数
+    quint64 timedOutCount() const { return m_timedOut; } // 等待确认超时的命令数
+    double lastLatencyMs() const { return m_lastLatencyUs / 1000.0; }
+    double maxLatencyMs() const { return m_maxLatencyUs / 1000.0; }
+    double averageLatencyMs() const { return m_sent ? m_totalLatencyUs / 1000.0 / m_sent : 0.0; }
+
+private:
+    struct Command
+    {
+        QByteArray data;
+        QByteArray kind;
+        qint64 enqueuedNs;
+    };
+
+    void writeNext();
+    void finishInFlight();
+    void onWriteTimeout();
+
+    Transport *m_transport = nullptr;
+    QList<Command> m_queue;
+    int m_capacity;
+    QElapsedTimer m_clock;
+
+    bool m_inFlight = false; // 当前命令已写入、尚未确认
+    qint64 m_inFlightEnd = 0; // 确认到这个字节数时当前命令写完
+    qint64 m_inFlightEnqueuedNs = 0;
+    qint64 m_bytesWritten = 0; // 交给传输层的累计字节数，包括超时放弃的命令
+    qint64 m_bytesConfirmed = 0; // bytesWritten 确认的累计字节数
+    int m_writeTimeoutMs = 1000;
+    QPointer<QTimer> m_writeTimer; // 挂在传输层对象上，和它在同一个线程
+
+
+    quint64 m_sent = 0;
+    quint64 m_superseded = 0;
+    quint64 m_dropped = 0;
+    quint64 m_timedOut = 0;
+    qint64 m_lastLatencyUs = 0;
+    qint64 m_maxLatencyUs = 0;
+    qint64 m_totalLatencyUs = 0;
+};
+
+#endif // COMMANDQUEUE_H
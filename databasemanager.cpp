@@ -1,22 +1,23 @@
 #include "databasemanager.h"
+#include "appsettings.h"
 
 DatabaseManager::DatabaseManager(QObject* parent) : QObject(parent)
 {
     // 确定数据库文件的存储位置
-#ifdef Q_OS_ANDROID
-    m_dbPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/robotcontrol.db";
-#else
-    m_dbPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/robotcontrol.db";
-#endif
+    m_dbPath = appDataDir() + "/robotcontrol.db";
 
     // 打开数据库并初始化表结构
     if (openDatabase()) {
         initDatabase();
     }
+
+    m_coalesceTimer.setSingleShot(true);
+    connect(&m_coalesceTimer, &QTimer::timeout, this, &DatabaseManager::flushPending);
 }
 
 DatabaseManager::~DatabaseManager()
 {
+    flushPending();
     closeDatabase();
 }
 
@@ -28,66 +29,395 @@ DatabaseManager& DatabaseManager::instance()
 
 bool DatabaseManager::openDatabase()
 {
+    {
+        QMutexLocker locker(&m_idMutex);
+        m_userIds.clear();
+        m_metricIds.clear();
+    }
     // 确保目录存在
     QDir dir;
     dir.mkpath(QFileInfo(m_dbPath).path());
 
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
-    m_db.setDatabaseName(m_dbPath);
+    // 打开当前（GUI）线程的连接，迁移在这个连接上执行
+    return threadConnection()->db.isOpen();
+}
 
-    if (!m_db.open()) {
-        qDebug() << "无法打开数据库:" << m_db.lastError().text();
-        return false;
+QSqlDatabase DatabaseManager::database()
+{
+    return threadConnection()->db;
+}
+
+int DatabaseManager::connectionCount() const
+{
+    QMutexLocker locker(&m_connectionsMutex);
+    return m_connections.size();
+}
+
+DatabaseManager::Connection* DatabaseManager::threadConnection()
+{
+    QThread* thread = QThread::currentThread();
+    {
+        QMutexLocker locker(&m_connectionsMutex);
+        auto it = m_connections.constFind(thread);
+        if (it != m_connections.constEnd()) {
+            return it.value();
+        }
     }
 
-    return true;
+    // QSqlDatabase 连接只能在创建它的线程中使用，每个线程按线程地址取一个连接名
+    Connection* connection = new Connection;
+    connection->name = QString("robotcontrol_%1").arg(quintptr(thread), 0, 16);
+    connection->db = QSqlDatabase::addDatabase("QSQLITE", connection->name);
+    connection->db.setDatabaseName(m_dbPath);
+    connection->db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000"); // 两个写入方同时提交时等待而不是直接失败
+    if (connection->db.open()) {
+        configureConnection(connection->db);
+    } else {
+        qDebug() << "无法打开数据库:" << connection->db.lastError().text();
+    }
+
+    // 线程结束时 finished 在该线程中发出，直接连接保证连接在它自己的线程里关闭
+    connect(thread, &QThread::finished, this, [this, thread]() { releaseConnection(thread); }, Qt::DirectConnection);
+
+    QMutexLocker locker(&m_connectionsMutex);
+    m_connections.insert(thread, connection);
+    return connection;
 }
 
-bool DatabaseManager::initDatabase()
+void DatabaseManager::releaseConnection(QThread* thread)
+{
+    Connection* connection = nullptr;
+    {
+        QMutexLocker locker(&m_connectionsMutex);
+        connection = m_connections.take(thread);
+    }
+    if (!connection) {
+        return;
+    }
+
+    // 预编译语句和连接对象都释放后才能移除连接
+    QString name = connection->name;
+    connection->statements.clear();
+    connection->failedStatement = QSqlQuery();
+    connection->db.close();
+    delete connection;
+    QSqlDatabase::removeDatabase(name);
+}
+
+void DatabaseManager::configureConnection(QSqlDatabase& db)
 {
-    QSqlQuery query;
+    QSqlQuery query(db);
 
-    // 创建用户表
-    if (!query.exec("CREATE TABLE IF NOT EXISTS users ("
-                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                    "username TEXT UNIQUE NOT NULL, "
-                    "password TEXT NOT NULL, "
-                    "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+    // WAL：写入追加到 -wal 文件，读取方看到的是开始读取时的快照，读写互不阻塞；该模式记录在数据库文件中
+    if (!query.exec("PRAGMA journal_mode = WAL") || !query.next()
+        || query.value(0).toString().compare("wal", Qt::CaseInsensitive) != 0) {
+        qDebug() << "无法启用 WAL 模式:" << query.lastError().text();
+    }
+
+    // WAL 下 NORMAL 只在检查点时同步磁盘，掉电最多丢失最后几个事务，不会损坏数据库
+    const char* const pragmas[] = {
+        "PRAGMA synchronous = NORMAL",
+        "PRAGMA cache_size = -8192",     // 每个连接 8 MB 页缓存
+        "PRAGMA mmap_size = 268435456",  // 读取最多 256 MB 通过内存映射，不经过页缓存拷贝
+        "PRAGMA temp_store = MEMORY",
+    };
+    for (const char* pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qDebug() << "设置" << pragma << "失败:" << query.lastError().text();
+        }
+    }
+}
+
+// 数据库迁移：按版本号顺序执行，每个迁移在一个事务中完成并记入 schema_version
+// 新的表结构变化只能追加新的迁移，不能修改已发布的迁移
+struct Migration
+{
+    int version;
+    const char* description;
+    QStringList statements;
+    QVector<QPair<QString, QString>> checks = {}; // 执行前统计受影响行数的查询（说明, SQL），结果写入日志
+};
+
+static const char* const kIsoToEpochMs =
+    "UPDATE %1 SET timestamp = CAST(ROUND((CASE "
+    "WHEN timestamp LIKE '%Z' OR timestamp GLOB '*[+-][0-9][0-9]:[0-9][0-9]' "
+    "  OR timestamp GLOB '[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9] *' THEN julianday(timestamp) "
+    "ELSE julianday(timestamp, 'utc') END - 2440587.5) * 86400000.0) AS INTEGER) "
+    "WHERE typeof(timestamp) = 'text'";
+
+// 汇总桶的起点（epoch 毫秒）：本地时间的当天 0 点，以及当周周一 0 点
+static const char* const kDayBucket =
+    "CAST(strftime('%s', timestamp / 1000, 'unixepoch', 'localtime', 'start of day', 'utc') AS INTEGER) * 1000";
+static const char* const kWeekBucket =
+    "CAST(strftime('%s', timestamp / 1000, 'unixepoch', 'localtime', 'weekday 0', '-6 days', 'start of day', 'utc') AS INTEGER) * 1000";
+
+static QString rollupBackfill(int period, const char* bucket)
+{
+    return QString("INSERT INTO measurement_rollups (user_id, metric_id, period, bucket, sample_count, "
+                   "min_value, max_value, value_sum, first_ts, last_ts) "
+                   "SELECT user_id, metric_id, %1, bucket, COUNT(*), MIN(value), MAX(value), SUM(value), "
+                   "MIN(timestamp), MAX(timestamp) "
+                   "FROM (SELECT user_id, metric_id, timestamp, value, %2 AS bucket FROM measurements) "
+                   "GROUP BY user_id, metric_id, bucket").arg(period).arg(bucket);
+}
+
+static const QVector<Migration>& migrations()
+{
+    static const QVector<Migration> list = {
+        {1, "基础表", {
+            "CREATE TABLE IF NOT EXISTS users ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "username TEXT UNIQUE NOT NULL, "
+            "password TEXT NOT NULL, "
+            "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+            ")",
+            "CREATE TABLE IF NOT EXISTS weight_records ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "username TEXT NOT NULL, "
+            "weight REAL NOT NULL, "
+            "timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "FOREIGN KEY(username) REFERENCES users(username)"
+            ")",
+            "CREATE TABLE IF NOT EXISTS percentage_records ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "username TEXT NOT NULL, "
+            "percentage REAL NOT NULL, "
+            "timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "FOREIGN KEY(username) REFERENCES users(username)"
+            ")",
+            // 实时采样点表（由 StreamWriter 在后台线程批量写入，时间戳为 epoch 毫秒）
+            "CREATE TABLE IF NOT EXISTS sensor_samples ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "username TEXT NOT NULL, "
+            "channel TEXT NOT NULL, "
+            "timestamp INTEGER NOT NULL, "
+            "value REAL NOT NULL"
+            ")",
+            "CREATE INDEX IF NOT EXISTS idx_sensor_samples_user_channel_time "
+            "ON sensor_samples (username, channel, timestamp)",
+        }},
+        // 最新值和历史查询按 (username, timestamp) 走索引；索引带上数值列，查询不用回表
+        {2, "体重/百分比记录的 (username, timestamp) 覆盖索引", {
+            "CREATE INDEX IF NOT EXISTS idx_weight_records_user_time "
+            "ON weight_records (username, timestamp, weight)",
+            "CREATE INDEX IF NOT EXISTS idx_percentage_records_user_time "
+            "ON percentage_records (username, timestamp, percentage)",
+        }},
+        // 时间戳由 ISO-8601 文本改为 epoch 毫秒整数：范围条件按整数比较，读取时不再逐行解析字符串。
+        // Qt::ISODate 写出的本地时间不带时区，按本地时间换算；带 Z/偏移量的和 CURRENT_TIMESTAMP 的 UTC 文本按原样换算
+        {3, "时间戳改为 epoch 毫秒", {
+            QString(kIsoToEpochMs).arg("weight_records"),
+            QString(kIsoToEpochMs).arg("percentage_records"),
+        }},
+        // 所有指标合并到一张 measurements 表：整数用户 id + 指标 id，主键即覆盖索引（WITHOUT ROWID，行内不重复存用户名）。
+        // 没有对应用户的旧记录无法关联，原样转存到 orphan_measurements 中，不丢弃；
+        // 旧时间戳只精确到秒，同一秒内的多次编辑按 id 顺序写入，保留最后一次
+        {4, "统一的 measurements 表", {
+            "CREATE TABLE metrics ("
+            "id INTEGER PRIMARY KEY, "
+            "name TEXT UNIQUE NOT NULL"
+            ")",
+            "INSERT INTO metrics (name) VALUES ('weight'), ('percentage')",
+            "CREATE TABLE measurements ("
+            "user_id INTEGER NOT NULL REFERENCES users(id), "
+            "metric_id INTEGER NOT NULL REFERENCES metrics(id), "
+            "timestamp INTEGER NOT NULL, "
+            "value REAL NOT NULL, "
+            "PRIMARY KEY (user_id, metric_id, timestamp)"
+            ") WITHOUT ROWID",
+            "INSERT OR REPLACE INTO measurements (user_id, metric_id, timestamp, value) "
+            "SELECT u.id, m.id, r.timestamp, r.weight FROM weight_records r "
+            "JOIN users u ON u.username = r.username JOIN metrics m ON m.name = 'weight' ORDER BY r.id",
+            "INSERT OR REPLACE INTO measurements (user_id, metric_id, timestamp, value) "
+            "SELECT u.id, m.id, r.timestamp, r.percentage FROM percentage_records r "
+            "JOIN users u ON u.username = r.username JOIN metrics m ON m.name = 'percentage' ORDER BY r.id",
+            "CREATE TABLE orphan_measurements ("
+            "username TEXT NOT NULL, "
+            "metric TEXT NOT NULL, "
+            "timestamp INTEGER, "
+            "value REAL NOT NULL"
+            ")",
+            "INSERT INTO orphan_measurements (username, metric, timestamp, value) "
+            "SELECT username, 'weight', timestamp, weight FROM weight_records "
+            "WHERE username NOT IN (SELECT username FROM users) ORDER BY id",
+            "INSERT INTO orphan_measurements (username, metric, timestamp, value) "
+            "SELECT username, 'percentage', timestamp, percentage FROM percentage_records "
+            "WHERE username NOT IN (SELECT username FROM users) ORDER BY id",
+            "DROP TABLE weight_records",
+            "DROP TABLE percentage_records",
+        }, {
+            {"没有对应用户、转存到 orphan_measurements 的记录",
+             "SELECT (SELECT COUNT(*) FROM weight_records WHERE username NOT IN (SELECT username FROM users)) + "
+             "(SELECT COUNT(*) FROM percentage_records WHERE username NOT IN (SELECT username FROM users))"},
+            {"同一时间戳被后写入的记录覆盖的记录",
+             "SELECT (SELECT COUNT(*) - COUNT(DISTINCT username || '|' || timestamp) FROM weight_records "
+             "WHERE username IN (SELECT username FROM users)) + "
+             "(SELECT COUNT(*) - COUNT(DISTINCT username || '|' || timestamp) FROM percentage_records "
+             "WHERE username IN (SELECT username FROM users))"},
+        }},
+        // 按用户/指标/天和周的汇总，随每次写入在同一事务中增量更新；长时间范围的趋势图读汇总而不是原始记录
+        {5, "按天/周汇总的 measurement_rollups 表", {
+            "CREATE TABLE measurement_rollups ("
+            "user_id INTEGER NOT NULL, "
+            "metric_id INTEGER NOT NULL, "
+            "period INTEGER NOT NULL, "     // 0 = 天，1 = 周
+            "bucket INTEGER NOT NULL, "     // 桶起点，epoch 毫秒
+            "sample_count INTEGER NOT NULL, "
+            "min_value REAL NOT NULL, "
+            "max_value REAL NOT NULL, "
+            "value_sum REAL NOT NULL, "
+            "first_ts INTEGER NOT NULL, "
+            "first_value REAL, "
+            "last_ts INTEGER NOT NULL, "
+            "last_value REAL, "
+            "PRIMARY KEY (user_id, metric_id, period, bucket)"
+            ") WITHOUT ROWID",
+            rollupBackfill(0, kDayBucket),
+            rollupBackfill(1, kWeekBucket),
+            "UPDATE measurement_rollups SET "
+            "first_value = (SELECT value FROM measurements m WHERE m.user_id = measurement_rollups.user_id "
+            "AND m.metric_id = measurement_rollups.metric_id AND m.timestamp = measurement_rollups.first_ts), "
+            "last_value = (SELECT value FROM measurements m WHERE m.user_id = measurement_rollups.user_id "
+            "AND m.metric_id = measurement_rollups.metric_id AND m.timestamp = measurement_rollups.last_ts)",
+        }},
+        // 多台设备同时落盘时按设备（蓝牙地址或传输层描述串）区分，同一通道的数据不再交错在一起
+        {6, "sensor_samples 增加设备列", {
+            "ALTER TABLE sensor_samples ADD COLUMN device TEXT NOT NULL DEFAULT ''",
+            "DROP INDEX IF EXISTS idx_sensor_samples_user_channel_time",
+            "CREATE INDEX idx_sensor_samples_user_device_channel_time "
+            "ON sensor_samples (username, device, channel, timestamp)",
+        }},
+        // 断线重连时在断开时刻写入一行 value 为 NULL 的记录，读取历史时曲线在中断区间断开；
+        // SQLite 不能修改列约束，重建表
+        {7, "sensor_samples 的数值允许为空（断线标记）", {
+            "CREATE TABLE sensor_samples_new ("
+            "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+            "username TEXT NOT NULL, "
+            "device TEXT NOT NULL DEFAULT '', "
+            "channel TEXT NOT NULL, "
+            "timestamp INTEGER NOT NULL, "
+            "value REAL"
+            ")",
+            "INSERT INTO sensor_samples_new (id, username, device, channel, timestamp, value) "
+            "SELECT id, username, device, channel, timestamp, value FROM sensor_samples ORDER BY id",
+            "DROP TABLE sensor_samples",
+            "ALTER TABLE sensor_samples_new RENAME TO sensor_samples",
+            "CREATE INDEX idx_sensor_samples_user_device_channel_time "
+            "ON sensor_samples (username, device, channel, timestamp)",
+        }},
+    };
+    return list;
+}
+
+bool DatabaseManager::initDatabase()
+{
+    clearStatementCache(); // 表结构可能改变，缓存的语句重新预编译
+    QSqlQuery query(database());
+
+    // 已执行的迁移记录在 schema_version 中；旧版本创建的数据库没有这张表，从版本 0 开始，
+    // 基础表的迁移使用 IF NOT EXISTS，对已有的表不会重复创建
+    if (!query.exec("CREATE TABLE IF NOT EXISTS schema_version ("
+                    "version INTEGER PRIMARY KEY, "
+                    "description TEXT, "
+                    "applied_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
                     ")")) {
-        qDebug() << "创建用户表失败:" << query.lastError().text();
+        qDebug() << "创建版本表失败:" << query.lastError().text();
         return false;
     }
 
-    // 创建体重记录表
-    if (!query.exec("CREATE TABLE IF NOT EXISTS weight_records ("
-                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                    "username TEXT NOT NULL, "
-                    "weight REAL NOT NULL, "
-                    "timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-                    "FOREIGN KEY(username) REFERENCES users(username)"
-                    ")")) {
-        qDebug() << "创建体重记录表失败:" << query.lastError().text();
+    int current = 0;
+    if (query.exec("SELECT MAX(version) FROM schema_version") && query.next()) {
+        current = query.value(0).toInt();
+    }
+    query.finish();
+
+    for (const Migration& migration : migrations()) {
+        if (migration.version <= current) {
+            continue;
+        }
+        if (!runMigration(migration.version, migration.description, migration.statements, migration.checks)) {
+            return false;
+        }
+        current = migration.version;
+    }
+
+    clearStatementCache();
+    return true;
+}
+
+bool DatabaseManager::runMigration(int version, const QString& description, const QStringList& statements,
+                                   const QVector<QPair<QString, QString>>& checks)
+{
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        qDebug() << "开启迁移事务失败:" << db.lastError().text();
         return false;
     }
 
-    // 创建百分比记录表
-    if (!query.exec("CREATE TABLE IF NOT EXISTS percentage_records ("
-                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                    "username TEXT NOT NULL, "
-                    "percentage REAL NOT NULL, "
-                    "timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-                    "FOREIGN KEY(username) REFERENCES users(username)"
-                    ")")) {
-        qDebug() << "创建百分比记录表失败:" << query.lastError().text();
+    QSqlQuery query(db);
+    for (const auto& check : checks) {
+        if (!query.exec(check.second) || !query.next()) {
+            qDebug() << "数据库迁移" << version << "统计失败:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+        qint64 rows = query.value(0).toLongLong();
+        if (rows > 0) {
+            qDebug() << "数据库迁移" << version << ":" << check.first << rows << "条";
+        }
+        query.finish();
+    }
+
+    for (const QString& sql : statements) {
+        if (!query.exec(sql)) {
+            qDebug() << "数据库迁移" << version << description << "失败:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+
+    query.prepare("INSERT INTO schema_version (version, description) VALUES (?, ?)");
+    query.bindValue(0, version);
+    query.bindValue(1, description);
+    if (!query.exec() || !db.commit()) {
+        qDebug() << "记录数据库版本" << version << "失败:" << db.lastError().text();
+        db.rollback();
         return false;
     }
 
+    qDebug() << "数据库已迁移到版本" << version << ":" << description;
     return true;
 }
 
 void DatabaseManager::closeDatabase()
 {
-    m_db.close();
+    releaseConnection(QThread::currentThread());
+}
+
+QSqlQuery& DatabaseManager::preparedQuery(const QString& sql)
+{
+    // 同一条 SQL 在每个线程的连接上只预编译一次，之后每次调用只重新绑定参数
+    Connection* connection = threadConnection();
+    auto it = connection->statements.find(sql);
+    if (it == connection->statements.end()) {
+        QSqlQuery query(connection->db);
+        query.setForwardOnly(true); // 结果只顺序读取一遍，不缓存已读的行
+        if (!query.prepare(sql)) {
+            qDebug() << "预编译语句失败:" << query.lastError().text() << sql;
+            // 失败的语句不缓存，下次调用重试；本次返回的语句执行时会报错
+            connection->failedStatement = query;
+            return connection->failedStatement;
+        }
+        it = connection->statements.insert(sql, query);
+    }
+    return it.value();
+}
+
+void DatabaseManager::clearStatementCache()
+{
+    Connection* connection = threadConnection();
+    connection->statements.clear();
+    connection->failedStatement = QSqlQuery();
 }
 
 bool DatabaseManager::registerUser(const QString& username, const QString& password)
@@ -96,10 +426,9 @@ bool DatabaseManager::registerUser(const QString& username, const QString& passw
         return false;
     }
 
-    QSqlQuery query;
-    query.prepare("INSERT INTO users (username, password) VALUES (?, ?)");
-    query.addBindValue(username);
-    query.addBindValue(password);  // 在生产环境中应该使用哈希密码
+    QSqlQuery &query = preparedQuery("INSERT INTO users (username, password) VALUES (?, ?)");
+    query.bindValue(0, username);
+    query.bindValue(1, password);  // 在生产环境中应该使用哈希密码
 
     if (!query.exec()) {
         qDebug() << "注册用户失败:" << query.lastError().text();
@@ -115,12 +444,13 @@ bool DatabaseManager::loginUser(const QString& username, const QString& password
         return false;
     }
 
-    QSqlQuery query;
-    query.prepare("SELECT * FROM users WHERE username = ? AND password = ?");
-    query.addBindValue(username);
-    query.addBindValue(password);  // 在生产环境中应该使用哈希密码
+    QSqlQuery &query = preparedQuery("SELECT * FROM users WHERE username = ? AND password = ?");
+    query.bindValue(0, username);
+    query.bindValue(1, password);  // 在生产环境中应该使用哈希密码
 
-    if (!query.exec() || !query.next()) {
+    bool found = query.exec() && query.next();
+    query.finish(); // 缓存的语句用完即复位，释放读锁
+    if (!found) {
         qDebug() << "登录失败:" << query.lastError().text();
         return false;
     }
@@ -128,120 +458,566 @@ bool DatabaseManager::loginUser(const QString& username, const QString& password
     return true;
 }
 
-bool DatabaseManager::saveWeightData(const QString& username, double weight, const QDateTime& timestamp)
+int DatabaseManager::userId(const QString& username)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO weight_records (username, weight, timestamp) VALUES (:username, :weight, :timestamp)");
-    query.bindValue(":username", username);
-    query.bindValue(":weight", weight);
-    query.bindValue(":timestamp", timestamp.toString(Qt::ISODate));
+    {
+        QMutexLocker locker(&m_idMutex);
+        auto it = m_userIds.constFind(username);
+        if (it != m_userIds.constEnd()) {
+            return it.value();
+        }
+    }
 
-    if (!query.exec()) {
-        qDebug() << "保存体重数据失败:" << query.lastError().text();
-        qDebug() << "错误详情:" << query.lastError().databaseText();
-        return false;
+    QSqlQuery &query = preparedQuery("SELECT id FROM users WHERE username = ?");
+    query.bindValue(0, username);
+    int id = query.exec() && query.next() ? query.value(0).toInt() : -1;
+    query.finish();
+    if (id < 0) {
+        qDebug() << "未知用户:" << username;
+        return -1;
+    }
+    QMutexLocker locker(&m_idMutex);
+    m_userIds.insert(username, id);
+    return id;
+}
+
+int DatabaseManager::metricId(const QString& metric, bool create)
+{
+    {
+        QMutexLocker locker(&m_idMutex);
+        auto it = m_metricIds.constFind(metric);
+        if (it != m_metricIds.constEnd()) {
+            return it.value();
+        }
+    }
+
+    // 第一次使用的指标自动登记。id 缓存后各线程共用，登记必须在数据事务之外单独提交：
+    // 事务回滚会撤销登记，缓存里留下的 id 会被下一个新指标重新分配
+    if (create) {
+        QSqlQuery &insert = preparedQuery("INSERT OR IGNORE INTO metrics (name) VALUES (?)");
+        insert.bindValue(0, metric);
+        if (!insert.exec()) {
+            qDebug() << "登记指标失败:" << insert.lastError().text();
+            return -1;
+        }
+    }
+
+    QSqlQuery &query = preparedQuery("SELECT id FROM metrics WHERE name = ?");
+    query.bindValue(0, metric);
+    int id = query.exec() && query.next() ? query.value(0).toInt() : -1;
+    query.finish();
+    if (id >= 0) {
+        QMutexLocker locker(&m_idMutex);
+        m_metricIds.insert(metric, id);
+    }
+    return id;
+}
+
+bool DatabaseManager::saveMeasurement(const QString& username, const QString& metric, double value, const QDateTime& timestamp)
+{
+    return saveOrQueue(username, metric, value, timestamp);
+}
+
+bool DatabaseManager::saveMeasurements(const QString& username, const QString& metric,
+                                       const QVector<QPair<QDateTime, double>>& rows)
+{
+    if (rows.isEmpty()) {
+        return true;
     }
 
+    // 新指标先单独登记提交，再整批一个事务写入，只在提交时同步一次磁盘
+    if (metricId(metric) < 0) {
+        return false;
+    }
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        qDebug() << "开启事务失败:" << db.lastError().text();
+        return false;
+    }
+    for (const auto& row : rows) {
+        if (!insertMeasurement(username, metric, row.first.toMSecsSinceEpoch(), row.second)) {
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        qDebug() << "提交事务失败:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
     return true;
 }
 
-double DatabaseManager::getLatestWeight(const QString& username, double defaultValue)
+double DatabaseManager::getLatestMeasurement(const QString& username, const QString& metric, double defaultValue)
 {
-    QSqlQuery query;
-    query.prepare("SELECT weight FROM weight_records WHERE username = :username "
-                  "ORDER BY timestamp DESC LIMIT 1");
-    query.bindValue(":username", username);
+    int user = userId(username);
+    int metricKey = metricId(metric);
+    if (user < 0 || metricKey < 0) {
+        return defaultValue;
+    }
+
+    QSqlQuery &query = preparedQuery("SELECT value FROM measurements WHERE user_id = ? AND metric_id = ? "
+                                     "ORDER BY timestamp DESC LIMIT 1");
+    query.bindValue(0, user);
+    query.bindValue(1, metricKey);
 
     if (!query.exec()) {
-        qDebug() << "获取最新体重数据失败:" << query.lastError().text();
+        qDebug() << "获取最新" << metric << "数据失败:" << query.lastError().text();
         return defaultValue;
     }
 
-    if (query.next()) {
-        return query.value(0).toDouble();
-    } else {
-        // 没有数据时返回默认值
-        return defaultValue;
+    double value = query.next() ? query.value(0).toDouble() : defaultValue; // 没有数据时返回默认值
+    query.finish();
+    return value;
+}
+
+QHash<QString, double> DatabaseManager::getLatestMeasurements(const QString& username, const QStringList& metrics)
+{
+    QHash<QString, double> results;
+    int user = userId(username);
+    if (user < 0) {
+        return results;
+    }
+
+    // 一条查询取出该用户每个指标的最新值，每个指标在覆盖索引上只定位一次
+    QSqlQuery &query = preparedQuery("SELECT m.name, (SELECT value FROM measurements "
+                                     "WHERE user_id = ? AND metric_id = m.id ORDER BY timestamp DESC LIMIT 1) "
+                                     "FROM metrics m");
+    query.bindValue(0, user);
+
+    if (!query.exec()) {
+        qDebug() << "获取最新数据失败:" << query.lastError().text();
+        return results;
     }
+
+    while (query.next()) {
+        QString name = query.value(0).toString();
+        if (!query.value(1).isNull() && (metrics.isEmpty() || metrics.contains(name))) {
+            results.insert(name, query.value(1).toDouble());
+        }
+    }
+    query.finish();
+    return results;
 }
 
-QVector<QPair<QDateTime, double>> DatabaseManager::getWeightHistory(const QString& username)
+QVector<Sample> DatabaseManager::getMeasurements(const QString& username, const QString& metric, qint64 fromMs, qint64 toMs)
 {
-    QVector<QPair<QDateTime, double>> results;
+    QVector<Sample> results;
+    int user = userId(username);
+    int metricKey = metricId(metric);
+    if (user < 0 || metricKey < 0) {
+        return results;
+    }
 
-    QSqlQuery query;
-    query.prepare("SELECT timestamp, weight FROM weight_records WHERE username = :username ORDER BY timestamp");
-    query.bindValue(":username", username);
+    QSqlQuery &query = preparedQuery("SELECT timestamp, value FROM measurements "
+                                     "WHERE user_id = ? AND metric_id = ? AND timestamp >= ? AND timestamp <= ? "
+                                     "ORDER BY timestamp");
+    query.bindValue(0, user);
+    query.bindValue(1, metricKey);
+    query.bindValue(2, fromMs);
+    query.bindValue(3, toMs);
 
     if (!query.exec()) {
-        qDebug() << "获取体重历史失败:" << query.lastError().text();
+        qDebug() << "获取" << metric << "历史失败:" << query.lastError().text();
         return results;
     }
 
+    // 时间戳是整数毫秒，直接换算成秒，不构造 QDateTime
     while (query.next()) {
-        QDateTime timestamp = QDateTime::fromString(query.value(0).toString(), Qt::ISODate);
-        double weight = query.value(1).toDouble();
-        results.append(qMakePair(timestamp, weight));
+        results.append(Sample{query.value(0).toLongLong() / 1000.0, query.value(1).toDouble()});
     }
+    query.finish();
 
     return results;
 }
 
-bool DatabaseManager::savePercentageData(const QString& username, double percentage, const QDateTime& timestamp)
+QVector<Sample> DatabaseManager::getMeasurementsPage(const QString& username, const QString& metric,
+                                                     qint64 fromMs, qint64 toMs, int limit, qint64* nextFromMs)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO percentage_records (username, percentage, timestamp) VALUES (:username, :percentage, :timestamp)");
-    query.bindValue(":username", username);
-    query.bindValue(":percentage", percentage);
-    query.bindValue(":timestamp", timestamp.toString(Qt::ISODate));
+    QVector<Sample> results;
+    int user = userId(username);
+    int metricKey = metricId(metric);
+    if (user >= 0 && metricKey >= 0) {
+        readPage(user, metricKey, fromMs, toMs, limit, results);
+    }
+    if (nextFromMs) {
+        *nextFromMs = nextPageStart(results, fromMs, toMs);
+    }
+    return results;
+}
 
-    if (!query.exec()) {
-        qDebug() << "保存百分比数据失败:" << query.lastError().text();
-        qDebug() << "错误详情:" << query.lastError().databaseText();
+bool DatabaseManager::forEachMeasurementChunk(const QString& username, const QString& metric, qint64 fromMs, qint64 toMs,
+                                              int chunkSize, const SampleChunkCallback& callback)
+{
+    int user = userId(username);
+    int metricKey = metricId(metric);
+    if (user < 0 || metricKey < 0 || chunkSize <= 0) {
         return false;
     }
 
+    // 一块数据复用同一个数组；每块查询结束后语句已复位，callback 执行期间不占用读事务
+    QVector<Sample> chunk;
+    qint64 next = fromMs;
+    while (next <= toMs) {
+        chunk.resize(0);
+        if (!readPage(user, metricKey, next, toMs, chunkSize, chunk)) {
+            return false;
+        }
+        if (chunk.isEmpty() || !callback(chunk) || chunk.size() < chunkSize
+            || qRound64(chunk.last().timestamp * 1000.0) >= toMs) {
+            break;
+        }
+        next = nextPageStart(chunk, next, toMs);
+    }
     return true;
 }
 
-double DatabaseManager::getLatestPercentage(const QString& username, double defaultValue)
+bool DatabaseManager::readPage(int user, int metricKey, qint64 fromMs, qint64 toMs, int limit, QVector<Sample>& out)
 {
-    QSqlQuery query;
-    query.prepare("SELECT percentage FROM percentage_records WHERE username = :username "
-                  "ORDER BY timestamp DESC LIMIT 1");
-    query.bindValue(":username", username);
+    if (limit <= 0 || fromMs > toMs) {
+        return true;
+    }
+
+    // 从上一页最后的时间戳续读（而不是 OFFSET），每页都只在主键上定位一次
+    QSqlQuery &query = preparedQuery("SELECT timestamp, value FROM measurements "
+                                     "WHERE user_id = ? AND metric_id = ? AND timestamp >= ? AND timestamp <= ? "
+                                     "ORDER BY timestamp LIMIT ?");
+    query.bindValue(0, user);
+    query.bindValue(1, metricKey);
+    query.bindValue(2, fromMs);
+    query.bindValue(3, toMs);
+    query.bindValue(4, limit);
 
     if (!query.exec()) {
-        qDebug() << "获取最新百分比数据失败:" << query.lastError().text();
-        return defaultValue;
+        qDebug() << "分页获取历史失败:" << query.lastError().text();
+        return false;
     }
 
-    if (query.next()) {
-        return query.value(0).toDouble();
-    } else {
-        // 没有数据时返回默认值
-        return defaultValue;
+    out.reserve(out.size() + limit);
+    while (query.next()) {
+        out.append(Sample{query.value(0).toLongLong() / 1000.0, query.value(1).toDouble()});
+    }
+    query.finish();
+    return true;
+}
+
+qint64 DatabaseManager::nextPageStart(const QVector<Sample>& page, qint64 fromMs, qint64 toMs)
+{
+    if (page.isEmpty()) {
+        return fromMs;
     }
+    // 同一用户、指标、毫秒只有一条，下一页从最后一条的下一毫秒开始；已到 toMs 时返回 toMs 之后表示取完
+    qint64 last = qRound64(page.last().timestamp * 1000.0);
+    return last < toMs ? last + 1 : (toMs < std::numeric_limits<qint64>::max() ? toMs + 1 : toMs);
+}
+
+bool DatabaseManager::saveWeightData(const QString& username, double weight, const QDateTime& timestamp)
+{
+    return saveMeasurement(username, "weight", weight, timestamp);
+}
+
+bool DatabaseManager::saveWeightBatch(const QString& username, const QVector<QPair<QDateTime, double>>& rows)
+{
+    return saveMeasurements(username, "weight", rows);
+}
+
+double DatabaseManager::getLatestWeight(const QString& username, double defaultValue)
+{
+    return getLatestMeasurement(username, "weight", defaultValue);
+}
+
+QVector<QPair<QDateTime, double>> DatabaseManager::getWeightHistory(const QString& username)
+{
+    return toDateTimePairs(getWeightSamples(username));
+}
+
+QVector<QPair<QDateTime, double>> DatabaseManager::getWeightHistory(const QString& username, const QDateTime& from,
+                                                                    const QDateTime& to)
+{
+    return toDateTimePairs(getWeightSamples(username, from.toMSecsSinceEpoch(), to.toMSecsSinceEpoch()));
+}
+
+QVector<Sample> DatabaseManager::getWeightSamples(const QString& username, qint64 fromMs, qint64 toMs)
+{
+    return getMeasurements(username, "weight", fromMs, toMs);
+}
+
+bool DatabaseManager::savePercentageData(const QString& username, double percentage, const QDateTime& timestamp)
+{
+    return saveMeasurement(username, "percentage", percentage, timestamp);
+}
+
+bool DatabaseManager::savePercentageBatch(const QString& username, const QVector<QPair<QDateTime, double>>& rows)
+{
+    return saveMeasurements(username, "percentage", rows);
+}
+
+double DatabaseManager::getLatestPercentage(const QString& username, double defaultValue)
+{
+    return getLatestMeasurement(username, "percentage", defaultValue);
 }
 
 QVector<QPair<QDateTime, double>> DatabaseManager::getPercentageHistory(const QString& username)
+{
+    return toDateTimePairs(getPercentageSamples(username));
+}
+
+QVector<QPair<QDateTime, double>> DatabaseManager::getPercentageHistory(const QString& username, const QDateTime& from,
+                                                                        const QDateTime& to)
+{
+    return toDateTimePairs(getPercentageSamples(username, from.toMSecsSinceEpoch(), to.toMSecsSinceEpoch()));
+}
+
+QVector<Sample> DatabaseManager::getPercentageSamples(const QString& username, qint64 fromMs, qint64 toMs)
+{
+    return getMeasurements(username, "percentage", fromMs, toMs);
+}
+
+QVector<QPair<QDateTime, double>> DatabaseManager::toDateTimePairs(const QVector<Sample>& samples)
 {
     QVector<QPair<QDateTime, double>> results;
+    results.reserve(samples.size());
+    for (const Sample& sample : samples) {
+        results.append(qMakePair(QDateTime::fromMSecsSinceEpoch(qRound64(sample.timestamp * 1000.0)), sample.value));
+    }
+    return results;
+}
+
+bool DatabaseManager::insertMeasurement(const QString& username, const QString& metric, qint64 timestampMs, double value)
+{
+    int user = userId(username);
+    int metricKey = metricId(metric, false);
+    if (user < 0 || metricKey < 0) {
+        qDebug() << "写入" << metric << "失败: 用户或指标不存在";
+        return false;
+    }
 
-    QSqlQuery query;
-    query.prepare("SELECT timestamp, percentage FROM percentage_records WHERE username = :username ORDER BY timestamp");
-    query.bindValue(":username", username);
+    // 同一用户、指标、毫秒只保留一条，后写入的覆盖先写入的
+    QSqlQuery &insert = preparedQuery("INSERT OR IGNORE INTO measurements (user_id, metric_id, timestamp, value) "
+                                      "VALUES (?, ?, ?, ?)");
+    insert.bindValue(0, user);
+    insert.bindValue(1, metricKey);
+    insert.bindValue(2, timestampMs);
+    insert.bindValue(3, value);
+    if (!insert.exec()) {
+        qDebug() << "写入" << metric << "失败:" << insert.lastError().text();
+        qDebug() << "错误详情:" << insert.lastError().databaseText();
+        return false;
+    }
+    if (insert.numRowsAffected() > 0) {
+        // 新记录：汇总直接累加
+        return updateRollup(user, metricKey, RollupPeriod::Day, timestampMs, value)
+            && updateRollup(user, metricKey, RollupPeriod::Week, timestampMs, value);
+    }
+
+    // 覆盖已有记录：旧值无法从汇总中减去，重新统计这一天和这一周
+    QSqlQuery &update = preparedQuery("UPDATE measurements SET value = ? "
+                                      "WHERE user_id = ? AND metric_id = ? AND timestamp = ?");
+    update.bindValue(0, value);
+    update.bindValue(1, user);
+    update.bindValue(2, metricKey);
+    update.bindValue(3, timestampMs);
+    if (!update.exec()) {
+        qDebug() << "更新" << metric << "失败:" << update.lastError().text();
+        return false;
+    }
+    return rebuildRollup(user, metricKey, RollupPeriod::Day, timestampMs)
+        && rebuildRollup(user, metricKey, RollupPeriod::Week, timestampMs);
+}
+
+qint64 DatabaseManager::rollupBucket(qint64 timestampMs, RollupPeriod period, qint64* endMs)
+{
+    // 与迁移中的 SQL 一致：本地时间的当天 0 点，或当周周一 0 点
+    QDate date = QDateTime::fromMSecsSinceEpoch(timestampMs).date();
+    if (period == RollupPeriod::Week) {
+        date = date.addDays(1 - date.dayOfWeek());
+    }
+    if (endMs) {
+        *endMs = date.addDays(period == RollupPeriod::Week ? 7 : 1).startOfDay().toMSecsSinceEpoch();
+    }
+    return date.startOfDay().toMSecsSinceEpoch();
+}
+
+bool DatabaseManager::updateRollup(int user, int metricKey, RollupPeriod period, qint64 timestampMs, double value)
+{
+    // 桶不存在时插入，存在时在原值上累加；SET 中引用的都是更新前的值
+    QSqlQuery &query = preparedQuery("INSERT INTO measurement_rollups (user_id, metric_id, period, bucket, sample_count, "
+                                     "min_value, max_value, value_sum, first_ts, first_value, last_ts, last_value) "
+                                     "VALUES (?, ?, ?, ?, 1, ?, ?, ?, ?, ?, ?, ?) "
+                                     "ON CONFLICT (user_id, metric_id, period, bucket) DO UPDATE SET "
+                                     "sample_count = sample_count + 1, "
+                                     "min_value = MIN(min_value, excluded.min_value), "
+                                     "max_value = MAX(max_value, excluded.max_value), "
+                                     "value_sum = value_sum + excluded.value_sum, "
+                                     "first_value = CASE WHEN excluded.first_ts < first_ts THEN excluded.first_value ELSE first_value END, "
+                                     "first_ts = MIN(first_ts, excluded.first_ts), "
+                                     "last_value = CASE WHEN excluded.last_ts >= last_ts THEN excluded.last_value ELSE last_value END, "
+                                     "last_ts = MAX(last_ts, excluded.last_ts)");
+    query.bindValue(0, user);
+    query.bindValue(1, metricKey);
+    query.bindValue(2, int(period));
+    query.bindValue(3, rollupBucket(timestampMs, period));
+    query.bindValue(4, value);       // min
+    query.bindValue(5, value);       // max
+    query.bindValue(6, value);       // sum
+    query.bindValue(7, timestampMs); // first
+    query.bindValue(8, value);
+    query.bindValue(9, timestampMs); // last
+    query.bindValue(10, value);
+    if (!query.exec()) {
+        qDebug() << "更新汇总失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::rebuildRollup(int user, int metricKey, RollupPeriod period, qint64 timestampMs)
+{
+    qint64 endMs = 0;
+    qint64 startMs = rollupBucket(timestampMs, period, &endMs);
+
+    // 只扫描这一个桶内的记录；参数放在 b 中，各子查询共用
+    QSqlQuery &query = preparedQuery("WITH b (user_id, metric_id, period, start_ts, end_ts) AS (SELECT ?, ?, ?, ?, ?) "
+                                     "INSERT OR REPLACE INTO measurement_rollups (user_id, metric_id, period, bucket, "
+                                     "sample_count, min_value, max_value, value_sum, first_ts, first_value, last_ts, last_value) "
+                                     "SELECT b.user_id, b.metric_id, b.period, b.start_ts, COUNT(*), MIN(m.value), MAX(m.value), "
+                                     "SUM(m.value), MIN(m.timestamp), "
+                                     "(SELECT value FROM measurements WHERE user_id = b.user_id AND metric_id = b.metric_id "
+                                     "AND timestamp >= b.start_ts AND timestamp < b.end_ts ORDER BY timestamp LIMIT 1), "
+                                     "MAX(m.timestamp), "
+                                     "(SELECT value FROM measurements WHERE user_id = b.user_id AND metric_id = b.metric_id "
+                                     "AND timestamp >= b.start_ts AND timestamp < b.end_ts ORDER BY timestamp DESC LIMIT 1) "
+                                     "FROM b JOIN measurements m ON m.user_id = b.user_id AND m.metric_id = b.metric_id "
+                                     "AND m.timestamp >= b.start_ts AND m.timestamp < b.end_ts");
+    query.bindValue(0, user);
+    query.bindValue(1, metricKey);
+    query.bindValue(2, int(period));
+    query.bindValue(3, startMs);
+    query.bindValue(4, endMs);
+    if (!query.exec()) {
+        qDebug() << "重建汇总失败:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QVector<MeasurementRollup> DatabaseManager::getRollups(const QString& username, const QString& metric,
+                                                       RollupPeriod period, qint64 fromMs, qint64 toMs)
+{
+    QVector<MeasurementRollup> results;
+    int user = userId(username);
+    int metricKey = metricId(metric);
+    if (user < 0 || metricKey < 0) {
+        return results;
+    }
+
+    // 包含 fromMs 的那个桶也返回
+    QSqlQuery &query = preparedQuery("SELECT bucket, sample_count, min_value, max_value, value_sum, "
+                                     "first_ts, first_value, last_ts, last_value FROM measurement_rollups "
+                                     "WHERE user_id = ? AND metric_id = ? AND period = ? AND bucket >= ? AND bucket <= ? "
+                                     "ORDER BY bucket");
+    query.bindValue(0, user);
+    query.bindValue(1, metricKey);
+    query.bindValue(2, int(period));
+    query.bindValue(3, fromMs == std::numeric_limits<qint64>::min() ? fromMs : rollupBucket(fromMs, period));
+    query.bindValue(4, toMs);
 
     if (!query.exec()) {
-        qDebug() << "获取百分比历史失败:" << query.lastError().text();
+        qDebug() << "获取" << metric << "汇总失败:" << query.lastError().text();
         return results;
     }
 
     while (query.next()) {
-        QDateTime timestamp = QDateTime::fromString(query.value(0).toString(), Qt::ISODate);
-        double percentage = query.value(1).toDouble();
-        results.append(qMakePair(timestamp, percentage));
+        MeasurementRollup rollup;
+        rollup.bucket = query.value(0).toLongLong() / 1000.0;
+        rollup.count = query.value(1).toInt();
+        rollup.min = query.value(2).toDouble();
+        rollup.max = query.value(3).toDouble();
+        rollup.sum = query.value(4).toDouble();
+        rollup.firstTimestamp = query.value(5).toLongLong() / 1000.0;
+        rollup.first = query.value(6).toDouble();
+        rollup.lastTimestamp = query.value(7).toLongLong() / 1000.0;
+        rollup.last = query.value(8).toDouble();
+        results.append(rollup);
     }
-
+    query.finish();
     return results;
 }
+
+bool DatabaseManager::saveOrQueue(const QString& username, const QString& metric, double value, const QDateTime& timestamp)
+{
+    // 合并队列和定时器属于 GUI 线程，其他线程的保存直接写入
+    if (m_coalesceMs <= 0 || QThread::currentThread() != thread()) {
+        return saveMeasurements(username, metric, {qMakePair(timestamp, value)});
+    }
+
+    // 合并窗口内的连续编辑攒到一起，窗口结束时一个事务写入；不存在的用户永远写不进去，不入队
+    if (userId(username) < 0) {
+        return false;
+    }
+    m_pending.append(PendingRecord{username, metric, timestamp.toMSecsSinceEpoch(), value});
+    if (!m_coalesceTimer.isActive()) {
+        m_coalesceTimer.start(m_coalesceMs);
+    }
+    return true;
+}
+
+void DatabaseManager::setCoalesceWindow(int ms)
+{
+    m_coalesceMs = qMax(0, ms);
+    if (m_coalesceMs == 0) {
+        flushPending();
+    }
+}
+
+bool DatabaseManager::flushPending()
+{
+    m_coalesceTimer.stop();
+    if (m_pending.isEmpty()) {
+        return true;
+    }
+
+    QVector<PendingRecord> pending;
+    pending.swap(m_pending);
+
+    if (!writePending(pending)) {
+        // 调用方已经得到保存成功的结果，写入失败（包括写入线程提交时的 SQLITE_BUSY 超时）时放回队列稍后重试
+        pending += m_pending;
+        m_pending.swap(pending);
+        m_coalesceTimer.start(qMax(m_coalesceMs, 1000));
+        qDebug() << m_pending.size() << "条待写入的记录写入失败，稍后重试";
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::writePending(const QVector<PendingRecord>& pending)
+{
+    // 队列中出现的新指标在事务之前登记
+    for (const PendingRecord& record : pending) {
+        if (metricId(record.metric) < 0) {
+            return false;
+        }
+    }
+
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        qDebug() << "开启事务失败:" << db.lastError().text();
+        return false;
+    }
+
+    // 所有指标共用同一条缓存的插入语句，所有记录在同一个事务中提交
+    for (const PendingRecord& record : pending) {
+        if (!insertMeasurement(record.username, record.metric, record.timestampMs, record.value)) {
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit()) {
+        qDebug() << "提交事务失败:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
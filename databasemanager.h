@@ -9,39 +9,163 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QDateTime>
+#include <QTimer>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <functional>
+#include <limits>
+#include "sample.h"
 
+// 一个汇总桶（一天或一周）内某个指标的统计，时间均为 epoch 秒
+struct MeasurementRollup
+{
+    double bucket = 0;          // 桶起点：本地时间当天 0 点或当周周一 0 点
+    int count = 0;
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+    double firstTimestamp = 0;
+    double first = 0;
+    double lastTimestamp = 0;
+    double last = 0;
+
+    double mean() const { return count > 0 ? sum / count : 0.0; }
+};
+
+enum class RollupPeriod { Day = 0, Week = 1 };
+
+// 每个线程使用自己的数据库连接（WAL 模式）：后台线程写入时，GUI 和其他线程仍可并发读取历史数据。
+// 单例须先在 GUI 线程创建；之后各方法可在任意线程调用，连接在线程第一次访问时打开、线程结束时关闭
 class DatabaseManager : public QObject
 {
     Q_OBJECT
 public:
     static DatabaseManager& instance();
 
+    QString databasePath() const { return m_dbPath; }
+    QSqlDatabase database(); // 当前线程的连接，第一次调用时打开
+    int connectionCount() const; // 已打开的线程连接数
+
     // 用户相关方法
     bool registerUser(const QString& username, const QString& password);
     bool loginUser(const QString& username, const QString& password);
 
+    // 通用的指标存储：metric 为指标名（如 "weight"），首次使用时自动登记
+    bool saveMeasurement(const QString& username, const QString& metric, double value,
+                         const QDateTime& timestamp = QDateTime::currentDateTime());
+    bool saveMeasurements(const QString& username, const QString& metric,
+                          const QVector<QPair<QDateTime, double>>& rows); // 整批一个事务
+    double getLatestMeasurement(const QString& username, const QString& metric, double defaultValue = 0.0);
+    QHash<QString, double> getLatestMeasurements(const QString& username, const QStringList& metrics = QStringList()); // 一次查询取多个指标的最新值，没有数据的指标不出现在结果中
+    QVector<Sample> getMeasurements(const QString& username, const QString& metric,
+                                    qint64 fromMs = std::numeric_limits<qint64>::min(),
+                                    qint64 toMs = std::numeric_limits<qint64>::max()); // 按时间排序，timestamp 为 epoch 秒
+
+    // 键集分页：[fromMs, toMs] 内按时间排序的至多 limit 条，从主键上直接定位到 fromMs，不扫描之前的行。
+    // nextFromMs 返回下一页的起点；返回条数少于 limit 表示已经取完
+    QVector<Sample> getMeasurementsPage(const QString& username, const QString& metric,
+                                        qint64 fromMs, qint64 toMs, int limit, qint64* nextFromMs = nullptr);
+    // 流式读取：按 chunkSize 条一块依次交给 callback，callback 返回 false 时停止；查询失败返回 false。
+    // 每块是一次独立的分页查询，callback 中可以再调用本类的其他方法
+    using SampleChunkCallback = std::function<bool(const QVector<Sample>& chunk)>;
+    bool forEachMeasurementChunk(const QString& username, const QString& metric, qint64 fromMs, qint64 toMs,
+                                 int chunkSize, const SampleChunkCallback& callback);
+
+    // 按天/周的汇总：写入时在同一事务中增量维护，读取代价只与桶数有关，与原始记录数无关
+    QVector<MeasurementRollup> getRollups(const QString& username, const QString& metric, RollupPeriod period,
+                                          qint64 fromMs = std::numeric_limits<qint64>::min(),
+                                          qint64 toMs = std::numeric_limits<qint64>::max());
+
+    // 批量写入：整批一个事务，复用同一条预编译语句
+    bool saveWeightBatch(const QString& username, const QVector<QPair<QDateTime, double>>& rows);
+    bool savePercentageBatch(const QString& username, const QVector<QPair<QDateTime, double>>& rows);
+
+    // 合并窗口：大于 0 时 GUI 线程的单条保存先进入队列，窗口结束时一个事务写入；0（默认）为立即写入
+    void setCoalesceWindow(int ms);
+    bool flushPending(); // 立即写入队列中的数据；失败时数据留在队列中，稍后自动重试
+
     // 体重相关方法
     bool saveWeightData(const QString& username, double weight,
                         const QDateTime& timestamp = QDateTime::currentDateTime());
     double getLatestWeight(const QString& username, double defaultValue = 0.0);
     QVector<QPair<QDateTime, double>> getWeightHistory(const QString& username);
+    QVector<QPair<QDateTime, double>> getWeightHistory(const QString& username, const QDateTime& from,
+                                                       const QDateTime& to = QDateTime::currentDateTime());
+    QVector<Sample> getWeightSamples(const QString& username,
+                                     qint64 fromMs = std::numeric_limits<qint64>::min(),
+                                     qint64 toMs = std::numeric_limits<qint64>::max()); // 按时间排序，timestamp 为 epoch 秒，可直接用作曲线横坐标
 
     // 百分比相关方法
     bool savePercentageData(const QString& username, double percentage,
                             const QDateTime& timestamp = QDateTime::currentDateTime());
     double getLatestPercentage(const QString& username, double defaultValue = 0.0);
     QVector<QPair<QDateTime, double>> getPercentageHistory(const QString& username);
+    QVector<QPair<QDateTime, double>> getPercentageHistory(const QString& username, const QDateTime& from,
+                                                           const QDateTime& to = QDateTime::currentDateTime());
+    QVector<Sample> getPercentageSamples(const QString& username,
+                                         qint64 fromMs = std::numeric_limits<qint64>::min(),
+                                         qint64 toMs = std::numeric_limits<qint64>::max());
 
 private:
     DatabaseManager(QObject* parent = nullptr);
     ~DatabaseManager();
 
+    // 一个线程的连接及其预编译语句缓存
+    struct Connection
+    {
+        QString name;
+        QSqlDatabase db;
+        QHash<QString, QSqlQuery> statements;
+        QSqlQuery failedStatement;
+    };
+
     bool openDatabase();
-    bool initDatabase();
-    void closeDatabase();
+    bool initDatabase(); // 执行尚未执行的数据库迁移
+    bool runMigration(int version, const QString& description, const QStringList& statements,
+                      const QVector<QPair<QString, QString>>& checks);
+    void closeDatabase(); // 关闭当前线程的连接
+
+    Connection* threadConnection(); // 当前线程的连接，不存在时打开并登记
+    void releaseConnection(QThread* thread); // 必须在该线程中调用
+    static void configureConnection(QSqlDatabase& db);
+
+    // 当前线程连接的预编译语句缓存：按 SQL 文本缓存，重新连接或表结构变化时清空
+    QSqlQuery& preparedQuery(const QString& sql);
+    void clearStatementCache();
+
+    int userId(const QString& username); // 用户名 -> users.id，-1 表示不存在
+    int metricId(const QString& metric, bool create = true); // 指标名 -> metrics.id，create 时登记不存在的指标；登记不能在事务中进行
+    bool insertMeasurement(const QString& username, const QString& metric, qint64 timestampMs, double value); // 须在事务中调用，指标须已登记；同时更新汇总
+    static qint64 rollupBucket(qint64 timestampMs, RollupPeriod period, qint64* endMs = nullptr); // 桶起点，endMs 返回下一个桶的起点
+    bool updateRollup(int user, int metricKey, RollupPeriod period, qint64 timestampMs, double value);
+    bool rebuildRollup(int user, int metricKey, RollupPeriod period, qint64 timestampMs);
+    bool saveOrQueue(const QString& username, const QString& metric, double value, const QDateTime& timestamp);
+    bool readPage(int user, int metricKey, qint64 fromMs, qint64 toMs, int limit, QVector<Sample>& out); // 追加到 out，查询失败返回 false
+    static qint64 nextPageStart(const QVector<Sample>& page, qint64 fromMs, qint64 toMs);
+    static QVector<QPair<QDateTime, double>> toDateTimePairs(const QVector<Sample>& samples);
 
-    QSqlDatabase m_db;
     QString m_dbPath;
+    QHash<QThread*, Connection*> m_connections;
+    mutable QMutex m_connectionsMutex;
+
+    // 名称 -> id 缓存，各线程共享
+    QHash<QString, int> m_userIds;
+    QHash<QString, int> m_metricIds;
+    QMutex m_idMutex;
+
+    // 合并窗口内排队的单条写入（只在 GUI 线程访问）
+    struct PendingRecord
+    {
+        QString username;
+        QString metric;
+        qint64 timestampMs;
+        double value;
+    };
+    QVector<PendingRecord> m_pending;
+    bool writePending(const QVector<PendingRecord>& pending); // 一个事务写入
+    QTimer m_coalesceTimer;
+    int m_coalesceMs = 0;
 
     // 禁止复制
     DatabaseManager(const DatabaseManager&) = delete;
@@ -0,0 +1,303 @@
+#include "devicesession.h"
+#include <QDebug>
+#include <QRandomGenerator>
+
+DeviceSession::DeviceSession(int id, bool threaded, int ringCapacity, QObject *parent)
+    : QObject(parent)
+    , m_id(id)
+    , m_device(new BlueDevice())
+    , m_label(QString("设备 %1").arg(id + 1))
+{
+    connect(m_device, &BlueDevice::connectionEstablished, this, &DeviceSession::onConnectionEstablished);
+    connect(m_device, &BlueDevice::connectionLost, this, &DeviceSession::onConnectionLost);
+    connect(m_device, &BlueDevice::connectionFailed, this, &DeviceSession::onConnectionLost);
+
+    m_reconnectTimer.setSingleShot(true);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &DeviceSession::reconnect);
+    connect(m_device, &BlueDevice::channelCountDetected, this, [this](int count) {
+        emit channelCountDetected(m_id, count);
+    });
+
+    if (!threaded) {
+        // 单线程模式：蓝牙对象留在 GUI 线程，采样点通过信号直接送达
+        m_device->setParent(this);
+        connect(m_device, &BlueDevice::samplesReceived, this, [this](const SampleBatch &samples) {
+            emit samplesReceived(m_id, samples);
+        });
+        return;
+    }
+
+    m_ring.reset(new SpscRing<Sample>(size_t(ringCapacity)));
+    m_device->setSampleRing(m_ring.data());
+    m_device->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_device, &QObject::deleteLater);
+    m_thread.setObjectName(QString("BluetoothIngest-%1").arg(id));
+    m_thread.start(QThread::HighPriority);
+}
+
+DeviceSession::~DeviceSession()
+{
+    if (m_thread.isRunning()) {
+        QMetaObject::invokeMethod(m_device, &BlueDevice::disconnectDevice, Qt::BlockingQueuedConnection);
+        m_thread.quit();
+        m_thread.wait();
+    }
+}
+
+void DeviceSession::setState(State state)
+{
+    if (m_state != state) {
+        m_state = state;
+        emit stateChanged(m_id, state);
+    }
+}
+
+void DeviceSession::connectToDevice(const QBluetoothDeviceInfo &info)
+{
+    m_target = info;
+    m_targetSpec.clear();
+    m_address = info.address();
+    m_label = info.name().isEmpty() ? info.address().toString() : info.name();
+    m_wantConnected = true;
+    m_attempt = 0;
+    m_lostAt = 0;
+    m_reconnectTimer.stop();
+    setState(State::Connecting);
+    invoke([device = m_device, info]() { device->connectToDevice(info); });
+}
+
+void DeviceSession::connectToTransport(const QString &spec)
+{
+    m_target = QBluetoothDeviceInfo();
+    m_targetSpec = spec;
+    m_address = QBluetoothAddress();
+    m_label = spec;
+    // 文件和抓包回放读完即结束，不做重连
+    m_wantConnected = !spec.startsWith("file:") && !spec.startsWith("replay:");
+    m_attempt = 0;
+    m_lostAt = 0;
+    m_reconnectTimer.stop();
+    setState(State::Connecting);
+    invoke([device = m_device, spec]() { device->connectToTransport(spec); });
+}
+
+void DeviceSession::setReconnectPolicy(bool enabled, int initialDelayMs, int maxDelayMs)
+{
+    m_reconnectEnabled = enabled;
+    m_initialDelayMs = qMax(1, initialDelayMs);
+    m_maxDelayMs = qMax(m_initialDelayMs, maxDelayMs);
+    if (!enabled) {
+        m_reconnectTimer.stop();
+    }
+}
+
+void DeviceSession::onConnectionEstablished()
+{
+    m_attempt = 0;
+    setState(State::Connected);
+
+    if (m_lostAt > 0) {
+        double now = BlueDevice::clockTime();
+        qDebug() << m_label << "已重新连接，中断" << now - m_lostAt << "秒";
+        emit resumed(m_id, m_lostAt, now);
+        m_lostAt = 0;
+    }
+}
+
+void DeviceSession::onConnectionLost()
+{
+    if (m_state == State::Connected) {
+        m_lostAt = BlueDevice::clockTime(); // 与采样点时间戳同一个时钟
+    }
+
+    if (m_wantConnected && m_reconnectEnabled) {
+        scheduleReconnect();
+    } else {
+        setState(State::Idle);
+    }
+}
+
+void DeviceSession::scheduleReconnect()
+{
+    if (m_reconnectTimer.isActive()) {
+        return; // 断开和出错可能先后到达，只排一次
+    }
+
+    // 指数退避：初始间隔每次翻倍直到上限；实际等待取 [delay/2, delay] 内的随机值，避免多台设备同时重试
+    int shift = qMin(m_attempt, 16);
+    int delay = int(qMin<qint64>(m_maxDelayMs, qint64(m_initialDelayMs) << shift));
+    int wait = delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+    ++m_attempt;
+
+    qDebug() << m_label << "将在" << wait << "ms 后第" << m_attempt << "次重连";
+    setState(State::Reconnecting);
+    m_reconnectTimer.start(wait);
+}
+
+void DeviceSession::reconnect()
+{
+    if (!m_wantConnected) {
+        return;
+    }
+    if (!m_targetSpec.isEmpty()) {
+        invoke([device = m_device, spec = m_targetSpec]() { device->connectToTransport(spec); });
+    } else {
+        invoke([device = m_device, info = m_target]() { device->connectToDevice(info); });
+    }
+}
+
+void DeviceSession::sendData(const QByteArray &data, const QByteArray &kind)
+{
+    invoke([device = m_device, data, kind]() { device->sendData(data, kind); });
+}
+
+void DeviceSession::disconnectDevice()
+{
+    m_wantConnected = false;
+    m_reconnectTimer.stop();
+    if (m_state == State::Reconnecting) {
+        setState(State::Idle);
+    }
+    invoke([device = m_device]() { device->disconnectDevice(); });
+}
+
+size_t DeviceSession::drain(SampleBatch &out, size_t maxSamples)
+{
+    if (!m_ring) {
+        return 0;
+    }
+
+    size_t n = m_ring->drain(out, maxSamples);
+
+    quint64 overflow = m_ring->overflowCount();
+    if (overflow != m_lastOverflow) {
+        qDebug() << m_label << "采集环形缓冲区溢出，累计丢弃" << overflow << "个采样点";
+        m_lastOverflow = overflow;
+    }
+    return n;
+}
+
+DeviceSessionManager::DeviceSessionManager(bool threaded, int ringCapacity, int drainBudget, QObject *parent)
+    : QObject(parent)
+    , m_threaded(threaded)
+    , m_ringCapacity(ringCapacity)
+    , m_drainBudget(size_t(qMax(1, drainBudget)))
+{
+    if (m_threaded) {
+        // GUI 线程每帧轮询一次所有会话
+        m_drainTimer.setTimerType(Qt::PreciseTimer);
+        connect(&m_drainTimer, &QTimer::timeout, this, &DeviceSessionManager::drainAll);
+        m_drainTimer.start(16);
+    }
+}
+
+DeviceSessionManager::~DeviceSessionManager()
+{
+    qDeleteAll(m_sessions);
+}
+
+DeviceSession *DeviceSessionManager::createSession()
+{
+    DeviceSession *session = new DeviceSession(m_nextId++, m_threaded, m_ringCapacity);
+    connect(session, &DeviceSession::samplesReceived, this, &DeviceSessionManager::samplesReceived);
+    m_sessions.append(session);
+    emit sessionAdded(session);
+    return session;
+}
+
+void DeviceSessionManager::removeSession(int id)
+{
+    DeviceSession *target = session(id);
+    if (!target) {
+        return;
+    }
+    m_sessions.removeOne(target);
+    delete target;
+    emit sessionRemoved(id);
+}
+
+DeviceSession *DeviceSessionManager::session(int id) const
+{
+    for (DeviceSession *session : m_sessions) {
+        if (session->id() == id) {
+            return session;
+        }
+    }
+    return nullptr;
+}
+
+DeviceSession *DeviceSessionManager::sessionFor(const QBluetoothAddress &address) const
+{
+    if (address.isNull()) {
+        return nullptr;
+    }
+    for (DeviceSession *session : m_sessions) {
+        if (session->address() == address) {
+            return session;
+        }
+    }
+    return nullptr;
+}
+
+DeviceSession *DeviceSessionManager::idleSession() const
+{
+    for (DeviceSession *session : m_sessions) {
+        if (session->state() == DeviceSession::State::Idle) {
+            return session;
+        }
+    }
+    return nullptr;
+}
+
+int DeviceSessionManager::connectedCount() const
+{
+    int count = 0;
+    for (DeviceSession *session : m_sessions) {
+        if (session->state() == DeviceSession::State::Connected) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t DeviceSessionManager::ringOccupancy() const
+{
+    size_t total = 0;
+    for (DeviceSession *session : m_sessions) {
+        total += session->ringOccupancy();
+    }
+    return total;
+}
+
+quint64 DeviceSessionManager::ringOverflow() const
+{
+    quint64 total = 0;
+    for (DeviceSession *session : m_sessions) {
+        total += session->ringOverflow();
+    }
+    return total;
+}
+
+IngestStats DeviceSessionManager::stats() const
+{
+    IngestStats total;
+    for (DeviceSession *session : m_sessions) {
+        total += session->stats();
+    }
+    return total;
+}
+
+void DeviceSessionManager::drainAll()
+{
+    const int count = m_sessions.size();
+    for (int i = 0; i < count; ++i) {
+        DeviceSession *session = m_sessions.at((m_drainStart + i) % count);
+        m_drainBuffer.resize(0);
+        if (session->drain(m_drainBuffer, m_drainBudget) > 0) {
+            emit samplesReceived(session->id(), m_drainBuffer);
+        }
+    }
+    if (count > 0) {
+        m_drainStart = (m_drainStart + 1) % count;
+    }
+}
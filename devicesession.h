@@ -0,0 +1,120 @@
+#ifndef DEVICESESSION_H
+#define DEVICESESSION_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QScopedPointer>
+#include "bluetooth.h"
+
+// 一个设备连接：独立的 BlueDevice（传输层、重组、解码）、采集线程和环形缓冲区
+// 每个会话的数据只经过自己的线程和队列，一台设备变慢或出错不会拖累其他设备
+class DeviceSession : public QObject
+{
+    Q_OBJECT
+public:
+    enum class State { Idle, Connecting, Connected, Reconnecting };
+    Q_ENUM(State)
+
+    DeviceSession(int id, bool threaded, int ringCapacity, QObject *parent = nullptr);
+    ~DeviceSession();
+
+    int id() const { return m_id; }
+    BlueDevice *device() const { return m_device; }
+    bool isThreaded() const { return !m_ring.isNull(); }
+    State state() const { return m_state; }
+    QString label() const { return m_label; } // 设备名或传输层描述
+    QBluetoothAddress address() const { return m_address; }
+    // 落盘用的设备标识：蓝牙地址，本地传输层为描述串；与会话 id 不同，跨重连和重启保持不变
+    QString deviceKey() const { return m_address.isNull() ? m_targetSpec : m_address.toString(); }
+
+    // 以下操作都转到会话所在线程执行
+    void connectToDevice(const QBluetoothDeviceInfo &info);
+    void connectToTransport(const QString &spec);
+    void sendData(const QByteArray &data, const QByteArray &kind = QByteArray());
+    void disconnectDevice(); // 主动断开，不再自动重连
+
+    // 自动重连：连接断开或连接失败后按指数退避加随机抖动重试上一个目标，直到连上或主动断开
+    void setReconnectPolicy(bool enabled, int initialDelayMs, int maxDelayMs);
+    int reconnectAttempts() const { return m_attempt; } // 本轮已重试次数
+    template <typename Func>
+    void invoke(Func func) { QMetaObject::invokeMethod(m_device, func); }
+
+    size_t drain(SampleBatch &out, size_t maxSamples); // 线程模式下从环形缓冲区取出至多 maxSamples 个采样点
+    size_t ringOccupancy() const { return m_ring ? m_ring->size() : 0; }
+    quint64 ringOverflow() const { return m_ring ? m_ring->overflowCount() : 0; }
+    IngestStats stats() const { return m_device->ingestStats(); } // 本会话的采集链路计数
+
+signals:
+    void stateChanged(int sessionId, DeviceSession::State state);
+    void samplesReceived(int sessionId, const SampleBatch &samples); // 单线程模式下转发 BlueDevice 的采样点
+    void channelCountDetected(int sessionId, int count);
+    void resumed(int sessionId, double gapStart, double gapEnd); // 断线后重新连上，gapStart/gapEnd 为断开和恢复的时间（秒）
+
+private:
+    void setState(State state);
+    void onConnectionEstablished();
+    void onConnectionLost(); // 连接断开或连接失败
+    void scheduleReconnect();
+    void reconnect();
+
+    int m_id;
+    BlueDevice *m_device;
+    QThread m_thread;
+    QScopedPointer<SpscRing<Sample>> m_ring;
+    State m_state = State::Idle;
+    QString m_label;
+    QBluetoothAddress m_address;
+    quint64 m_lastOverflow = 0;
+
+    QBluetoothDeviceInfo m_target; // 上一个连接目标：蓝牙设备或传输层描述串
+    QString m_targetSpec;
+    bool m_reconnectEnabled = true;
+    bool m_wantConnected = false; // 用户希望保持连接，主动断开时清除
+    int m_initialDelayMs = 500;
+    int m_maxDelayMs = 30000;
+    int m_attempt = 0;
+    QTimer m_reconnectTimer;
+    double m_lostAt = 0; // 最近一次断开的时间（秒），0 表示没有待恢复的断线
+};
+
+// 设备会话管理器：持有 N 个并发连接，GUI 线程每帧轮询所有会话的环形缓冲区
+// 每个会话每轮最多取 drainBudget 个采样点，并轮换起始会话，保证各设备公平
+class DeviceSessionManager : public QObject
+{
+    Q_OBJECT
+public:
+    DeviceSessionManager(bool threaded, int ringCapacity, int drainBudget, QObject *parent = nullptr);
+    ~DeviceSessionManager();
+
+    DeviceSession *createSession();
+    void removeSession(int id);
+    DeviceSession *session(int id) const;
+    const QList<DeviceSession *> &sessions() const { return m_sessions; }
+    DeviceSession *sessionFor(const QBluetoothAddress &address) const; // 已绑定该地址的会话
+    DeviceSession *idleSession() const; // 空闲（未连接也未在连接中）的会话
+    int connectedCount() const;
+
+    size_t ringOccupancy() const; // 所有会话环形缓冲区占用之和
+    quint64 ringOverflow() const; // 所有会话溢出丢弃之和
+    IngestStats stats() const; // 所有会话的采集链路计数之和
+
+signals:
+    void sessionAdded(DeviceSession *session);
+    void sessionRemoved(int sessionId);
+    void samplesReceived(int sessionId, const SampleBatch &samples);
+
+private:
+    void drainAll();
+
+    QList<DeviceSession *> m_sessions;
+    int m_nextId = 0;
+    bool m_threaded;
+    int m_ringCapacity;
+    size_t m_drainBudget;
+    int m_drainStart = 0;
+    QTimer m_drainTimer;
+    SampleBatch m_drainBuffer;
+};
+
+#endif // DEVICESESSION_H
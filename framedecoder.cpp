@@ -0,0 +1,179 @@
+#include "framedecoder.h"
+#include <algorithm>
+#include <cstring>
+
+// 在 buffer 的 from 位置之后查找字节串，找不到返回 -1
+static int findBytes(const QByteArray &buffer, int from, const uchar *needle, int size)
+{
+    if (from > buffer.size()) {
+        return -1;
+    }
+    const char *begin = buffer.constData();
+    const char *end = begin + buffer.size();
+    const char *pattern = reinterpret_cast<const char *>(needle);
+    const char *it = std::search(begin + from, end, pattern, pattern + size);
+    return it == end ? -1 : int(it - begin);
+}
+
+FrameDecoder::FrameDecoder(int channelCount)
+{
+    setChannelCount(channelCount);
+}
+
+void FrameDecoder::setFormat(const FrameFormat *format)
+{
+    m_autoDetect = false;
+    m_format = format;
+    m_buffer.clear();
+}
+
+void FrameDecoder::setChannelCount(int count)
+{
+    m_autoDetect = count <= 0;
+    m_format = m_autoDetect ? nullptr : justFloatFormat(qMin(count, int(MaxChannels)));
+    m_buffer.clear();
+}
+
+int FrameDecoder::decode(SampleBatch &out, double timestamp, double frameInterval)
+{
+    m_lastDiscarded = 0;
+    m_highWater = qMax(m_highWater, int(m_buffer.size()));
+
+    if (!m_format && !(m_autoDetect && detectChannels())) {
+        // 识别出通道数之前最多保留 4 个最大帧长的数据
+        const int limit = 4 * (MaxChannels * 4 + JustFloatTail::size);
+        if (m_buffer.size() > limit) {
+            discard(m_buffer.size() - limit);
+        }
+        m_discardedBytes += m_lastDiscarded;
+        return 0;
+    }
+
+    const FrameFormat &format = *m_format;
+    const int tailOffset = format.frameSize - format.tailSize;
+
+    // 按缓冲区最多能容纳的帧数一次性预留输出空间，解码时直接写入
+    const int base = out.size();
+    out.resize(base + (m_buffer.size() / format.frameSize) * format.fieldCount);
+    Sample *dst = out.data() + base;
+
+    const uchar *data = reinterpret_cast<const uchar *>(m_buffer.constData());
+    int frames = 0;
+    int pos = 0;
+    while (m_buffer.size() - pos >= format.frameSize) {
+        const uchar *frame = data + pos;
+        if ((format.headerSize == 0 || memcmp(frame, format.header, format.headerSize) == 0)
+            && (format.tailSize == 0 || memcmp(frame + tailOffset, format.tail, format.tailSize) == 0)) {
+            format.decode(frame, timestamp, dst);
+            dst += format.fieldCount;
+            pos += format.frameSize;
+            ++frames;
+            continue;
+        }
+
+        // 帧头/帧尾不匹配：跳到下一个可能的帧起点，丢弃中间的字节
+        int next = nextCandidate(pos);
+        m_lastDiscarded += next - pos;
+        ++m_rejectedFrames;
+        pos = next;
+    }
+    out.resize(base + frames * format.fieldCount);
+
+    // 一次读到多帧时按帧间隔往前排开，帧数确定后再回填时间
+    if (frameInterval > 0 && frames > 1) {
+        Sample *sample = out.data() + base;
+        for (int frame = 0; frame < frames; ++frame) {
+            const double frameTime = timestamp - (frames - 1 - frame) * frameInterval;
+            for (int field = 0; field < format.fieldCount; ++field) {
+                (sample++)->timestamp = frameTime;
+            }
+        }
+    }
+
+    // 一次性移除已消费的字节，避免逐帧搬移缓冲区
+    if (pos > 0) {
+        m_buffer.remove(0, pos);
+    }
+    m_discardedBytes += m_lastDiscarded;
+    return frames;
+}
+
+int FrameDecoder::nextCandidate(int pos) const
+{
+    const FrameFormat &format = *m_format;
+
+    if (format.tailSize > 0) {
+        // 按帧尾同步：找到下一个帧尾，它所在帧的起点就是候选位置
+        const int tailOffset = format.frameSize - format.tailSize;
+        int tailPos = findBytes(m_buffer, pos + tailOffset + 1, format.tail, format.tailSize);
+        if (tailPos >= 0) {
+            return tailPos - tailOffset;
+        }
+        // 没有找到帧尾，只保留可能属于下一帧的最后 frameSize-1 个字节
+        return m_buffer.size() - (format.frameSize - 1);
+    }
+
+    // 只有帧头的格式按帧头同步
+    int headerPos = findBytes(m_buffer, pos + 1, format.header, format.headerSize);
+    if (headerPos >= 0) {
+        return headerPos;
+    }
+    return m_buffer.size() - (format.headerSize - 1);
+}
+
+void FrameDecoder::reset()
+{
+    m_buffer.clear();
+    m_lastDiscarded = 0;
+    if (m_autoDetect) {
+        // 重新连接的可能是另一台设备，重新识别通道数
+        m_format = nullptr;
+    }
+}
+
+bool FrameDecoder::detectChannels()
+{
+    const int tailSize = JustFloatTail::size;
+    const uchar *tail = JustFloatTail::bytes.data();
+    int positions[4];
+    int found = 0;
+    int from = 0;
+
+    for (;;) {
+        int pos = findBytes(m_buffer, from, tail, tailSize);
+        if (pos < 0) {
+            return false;
+        }
+        from = pos + tailSize;
+
+        if (found == 4) {
+            memmove(positions, positions + 1, 3 * sizeof(int));
+            found = 3;
+        }
+        positions[found++] = pos;
+        if (found < 4) {
+            continue;
+        }
+
+        const int interval = positions[1] - positions[0];
+        if (interval == positions[2] - positions[1] && interval == positions[3] - positions[2]
+            && interval > tailSize && (interval - tailSize) % 4 == 0
+            && (interval - tailSize) / 4 <= MaxChannels) {
+            m_format = justFloatFormat((interval - tailSize) / 4);
+
+            // 从第一个帧尾所在帧的帧头开始解码，帧头不完整时从下一帧开始
+            int start = positions[0] + tailSize - interval;
+            if (start < 0) {
+                start = positions[0] + tailSize;
+            }
+            discard(start);
+            return true;
+        }
+    }
+}
+
+void FrameDecoder::discard(int bytes)
+{
+    m_buffer.remove(0, bytes);
+    m_lastDiscarded += bytes;
+}
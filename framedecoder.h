@@ -0,0 +1,50 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QByteArray>
+#include "framelayout.h"
+#include "sample.h"
+
+// 帧重组器：在字节流中按帧头/帧尾同步，从任意大小的数据块中解出完整帧，残帧留待下次读取
+// 帧格式由 framelayout.h 中的编译期布局生成；默认是 JustFloat（N 个小端 float 加 00 00 80 7f 帧尾，共 4*N+4 字节），
+// JustFloat 的 N 可以指定，也可以从帧尾间距自动识别
+class FrameDecoder
+{
+public:
+    explicit FrameDecoder(int channelCount = 1);
+
+    // 接收缓冲区：传输层直接把数据追加到这里，避免中间拷贝
+    QByteArray &receiveBuffer() { return m_buffer; }
+
+    // 解码缓冲区中所有完整帧，采样点追加到 out 末尾，返回帧数；out 的容量会被复用，稳态下不分配内存。
+    // 最后一帧的时间记为 timestamp，之前的帧依次早 frameInterval 秒（0 表示共用同一个时间）
+    int decode(SampleBatch &out, double timestamp, double frameInterval = 0.0);
+    void reset(); // 清空重组缓冲区（连接建立/断开时调用）；自动识别模式下重新识别通道数
+
+    void setFormat(const FrameFormat *format); // 使用固定帧格式
+    void setChannelCount(int count); // 使用 JustFloat 格式，0 表示自动识别
+    int channelCount() const { return m_format ? m_format->fieldCount : 0; } // 自动识别完成前为 0
+    int frameSize() const { return m_format ? m_format->frameSize : 0; }
+    int pendingBytes() const { return m_buffer.size(); } // 缓冲区中尚未成帧的字节数
+    quint64 discardedBytes() const { return m_discardedBytes; } // 重同步累计丢弃的字节数
+    int lastDiscardedBytes() const { return m_lastDiscarded; } // 最近一次 decode 丢弃的字节数
+    quint64 rejectedFrames() const { return m_rejectedFrames; } // 帧头/帧尾不匹配而被跳过的候选帧数
+    int bufferHighWater() const { return m_highWater; } // 重组缓冲区占用峰值（字节）
+
+    static const int MaxChannels = kJustFloatMaxChannels;
+
+private:
+    bool detectChannels(); // 连续 4 个帧尾间距一致时确定 JustFloat 通道数
+    int nextCandidate(int pos) const; // 当前位置不是合法帧时，下一个可能的帧起点
+    void discard(int bytes);
+
+    const FrameFormat *m_format = nullptr;
+    bool m_autoDetect = false;
+    QByteArray m_buffer;
+    quint64 m_discardedBytes = 0;
+    int m_lastDiscarded = 0;
+    quint64 m_rejectedFrames = 0;
+    int m_highWater = 0;
+};
+
+#endif // FRAMEDECODER_H
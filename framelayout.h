@@ -0,0 +1,127 @@
+#ifndef FRAMELAYOUT_H
+#define FRAMELAYOUT_H
+
+#include <QtGlobal>
+#include <QtEndian>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+#include "sample.h"
+
+// 编译期帧格式描述
+//
+// 一个帧格式由帧头字节、帧尾字节和若干字段组成，字段给出类型、在有效载荷中的偏移和字节序。
+// 新增一种秤的协议只需要声明一个布局，例如：
+//
+//     using MyScaleLayout = FrameLayout<ByteSeq<0xAA, 0x55>, ByteSeq<>,
+//                                       Field<quint16, 0, Endian::Big>,   // 体重 * 100
+//                                       Field<float, 2>>;                 // 阻抗
+//     frameDecoder.setFormat(&frameFormatOf<MyScaleLayout>);
+//
+// 解码函数由模板展开生成，直接从接收缓冲区读字段，写入预先分配好的采样数组，不产生堆分配。
+
+enum class Endian { Little, Big };
+
+// 一串编译期字节（帧头或帧尾），可以为空
+template <quint8... Bytes>
+struct ByteSeq
+{
+    static constexpr int size = int(sizeof...(Bytes));
+    static constexpr std::array<uchar, sizeof...(Bytes)> bytes = {{Bytes...}};
+};
+
+template <int Size> struct RawType;
+template <> struct RawType<1> { using type = quint8; };
+template <> struct RawType<2> { using type = quint16; };
+template <> struct RawType<4> { using type = quint32; };
+template <> struct RawType<8> { using type = quint64; };
+
+// 有效载荷中的一个字段：类型 T，位于偏移 Offset，字节序 E
+template <typename T, int Offset, Endian E = Endian::Little>
+struct Field
+{
+    static constexpr int offset = Offset;
+    static constexpr int end = Offset + int(sizeof(T));
+
+    static double read(const uchar *payload)
+    {
+        using Raw = typename RawType<sizeof(T)>::type;
+        Raw raw = E == Endian::Little ? qFromLittleEndian<Raw>(payload + Offset)
+                                      : qFromBigEndian<Raw>(payload + Offset);
+        T value;
+        memcpy(&value, &raw, sizeof(T));
+        return double(value);
+    }
+};
+
+// 帧布局：帧头 + 有效载荷（各字段）+ 帧尾，第 i 个字段解码为通道 i
+template <typename Header, typename Tail, typename... Fields>
+struct FrameLayout
+{
+    static_assert(sizeof...(Fields) > 0, "帧布局至少需要一个字段");
+
+    using HeaderBytes = Header;
+    using TailBytes = Tail;
+    static constexpr int fieldCount = int(sizeof...(Fields));
+    static constexpr int payloadSize = std::max({Fields::end...});
+    static constexpr int frameSize = Header::size + payloadSize + Tail::size;
+
+    // 解码一帧，写出 fieldCount 个采样点
+    static void decode(const uchar *frame, double timestamp, Sample *out)
+    {
+        const uchar *payload = frame + Header::size;
+        int channel = 0;
+        ((out[channel] = Sample{timestamp, Fields::read(payload), channel}, ++channel), ...);
+    }
+};
+
+// 运行期使用的帧格式，由编译期布局生成，供 FrameDecoder 做同步和解码
+struct FrameFormat
+{
+    const uchar *header;
+    int headerSize;
+    const uchar *tail;
+    int tailSize;
+    int frameSize;
+    int fieldCount;
+    void (*decode)(const uchar *frame, double timestamp, Sample *out);
+};
+
+template <typename Layout>
+inline constexpr FrameFormat frameFormatOf = {
+    Layout::HeaderBytes::bytes.data(), Layout::HeaderBytes::size,
+    Layout::TailBytes::bytes.data(), Layout::TailBytes::size,
+    Layout::frameSize, Layout::fieldCount, &Layout::decode
+};
+
+// JustFloat：N 个小端 float，帧尾 00 00 80 7f
+using JustFloatTail = ByteSeq<0x00, 0x00, 0x80, 0x7f>;
+static const int kJustFloatMaxChannels = 32;
+
+template <int N, typename Seq = std::make_integer_sequence<int, N>>
+struct JustFloatLayoutOf;
+
+template <int N, int... I>
+struct JustFloatLayoutOf<N, std::integer_sequence<int, I...>>
+{
+    using type = FrameLayout<ByteSeq<>, JustFloatTail, Field<float, I * 4>...>;
+};
+
+template <int N>
+using JustFloatLayout = typename JustFloatLayoutOf<N>::type;
+
+template <int... I>
+constexpr std::array<const FrameFormat *, sizeof...(I)> makeJustFloatFormats(std::integer_sequence<int, I...>)
+{
+    return {{&frameFormatOf<JustFloatLayout<I + 1>>...}};
+}
+
+// N 通道 JustFloat 的帧格式，N 超出 1..kJustFloatMaxChannels 时返回 nullptr
+inline const FrameFormat *justFloatFormat(int channels)
+{
+    static constexpr auto formats = makeJustFloatFormats(std::make_integer_sequence<int, kJustFloatMaxChannels>());
+    return channels >= 1 && channels <= kJustFloatMaxChannels ? formats[channels - 1] : nullptr;
+}
+
+#endif // FRAMELAYOUT_H
@@ -0,0 +1,84 @@
+#ifndef INGESTSTATS_H
+#define INGESTSTATS_H
+
+#include <QtGlobal>
+#include <array>
+#include <cmath>
+
+// 采集链路的累计计数，由 BlueDevice 在采集线程更新，其他线程可随时读取快照
+struct IngestStats
+{
+    quint64 frames = 0;         // 解码出的帧数
+    quint64 bytes = 0;          // 接收的字节数
+    quint64 rejectedFrames = 0; // 帧头/帧尾不匹配被跳过的候选帧数
+    quint64 resyncBytes = 0;    // 重同步丢弃的字节数
+    int bufferHighWater = 0;    // 重组缓冲区占用峰值（字节）
+    size_t ringOccupancy = 0;   // 环形缓冲区当前占用（采样点）
+    size_t ringHighWater = 0;   // 环形缓冲区占用峰值（采样点）
+    quint64 ringOverflow = 0;   // 环形缓冲区写满丢弃的采样点
+
+    IngestStats &operator+=(const IngestStats &other)
+    {
+        frames += other.frames;
+        bytes += other.bytes;
+        rejectedFrames += other.rejectedFrames;
+        resyncBytes += other.resyncBytes;
+        bufferHighWater = qMax(bufferHighWater, other.bufferHighWater);
+        ringOccupancy += other.ringOccupancy;
+        ringHighWater = qMax(ringHighWater, other.ringHighWater);
+        ringOverflow += other.ringOverflow;
+        return *this;
+    }
+};
+
+// 延迟直方图：按 1/4 倍频程分桶（相对误差约 19%），记录 O(1)，不分配内存，用于估计分位数
+// 覆盖 1 微秒到约 134 秒
+class LatencyHistogram
+{
+public:
+    void record(double ms)
+    {
+        double us = qMax(1.0, ms * 1000.0);
+        int bucket = qMin(int(std::log2(us) * BucketsPerOctave), int(Buckets) - 1);
+        ++m_counts[size_t(bucket)];
+        ++m_total;
+        m_max = qMax(m_max, ms);
+    }
+
+    // p 取 0..1，返回该分位所在桶的上界（毫秒）；没有数据时返回 0
+    double percentile(double p) const
+    {
+        if (m_total == 0) {
+            return 0.0;
+        }
+        quint64 rank = quint64(std::ceil(p * double(m_total)));
+        quint64 seen = 0;
+        for (size_t i = 0; i < Buckets; ++i) {
+            seen += m_counts[i];
+            if (seen >= qMax<quint64>(1, rank)) {
+                return qMin(m_max, std::exp2(double(i + 1) / BucketsPerOctave) / 1000.0);
+            }
+        }
+        return m_max;
+    }
+
+    quint64 count() const { return m_total; }
+    double max() const { return m_max; }
+
+    void reset()
+    {
+        m_counts.fill(0);
+        m_total = 0;
+        m_max = 0.0;
+    }
+
+private:
+    static const int BucketsPerOctave = 4;
+    static const size_t Buckets = 27 * BucketsPerOctave;
+
+    std::array<quint64, Buckets> m_counts {};
+    quint64 m_total = 0;
+    double m_max = 0.0;
+};
+
+#endif // INGESTSTATS_H
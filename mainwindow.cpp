@@ -1,48 +1,151 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "appsettings.h"
+#include "servicecache.h"
 
 MainWindow::MainWindow(const QString& username, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , blueDevice(new BlueDevice())
     , m_username(username)
 {
     ui->setupUi(this);
     Adaptive_screen();
 
     setplot();   //设置绘图
+    setupRenderClock(); // 按固定帧率重绘
     setbutton();  //设置按钮
     loadUserData(); // 先加载用户数据
     setspinbox(); //设置输入框
+    DatabaseManager::instance().setCoalesceWindow(appSettings().value("storage/coalesceMs", 0).toInt()); // 连续编辑合并写入
     setLED(ui->flag, 1, 16);
     ui->listWidget->setStyleSheet("font-size: 20pt;");
 
     connect(ui->search_button, &QPushButton::clicked, this, &MainWindow::onStartDiscoveryClicked);
     connect(ui->connect_button, &QPushButton::clicked, this, &MainWindow::connectdevice);
 
-    connect(blueDevice, &BlueDevice::deviceDiscovered, this, &MainWindow::onDeviceDiscovered);
-    connect(blueDevice, &BlueDevice::connectionEstablished, this, &MainWindow::onConnectionEstablished);
-    connect(blueDevice, &BlueDevice::connectionLost, this, &MainWindow::onConnectionLost);
-    connect(blueDevice, &BlueDevice::dataReceived, this, &MainWindow::updateData);
+    setupSessions(); // 设置设备会话
 }
 
 MainWindow::~MainWindow()
 {
+    delete telemetry; // 遥测引用会话管理器，先删除
+    delete sessionManager; // 先停止所有采集线程
+    delete streamWriter; // 写完剩余数据
+    DatabaseManager::instance().flushPending(); // 合并窗口中尚未写入的编辑，趁应用对象还在时写入
     delete ui;
 }
 
+void MainWindow::setupSessions()
+{
+    sessionManager = new DeviceSessionManager(appSettings().value("ingest/threaded", true).toBool(),
+                                              appSettings().value("ingest/ringCapacity", 65536).toInt(),
+                                              appSettings().value("ingest/drainBudget", 20000).toInt());
+    connect(sessionManager, &DeviceSessionManager::sessionAdded, this, &MainWindow::configureSession);
+    connect(sessionManager, &DeviceSessionManager::sessionRemoved, this, &MainWindow::removeSessionGraphs);
+    connect(sessionManager, &DeviceSessionManager::samplesReceived, this, &MainWindow::updateData);
+
+    // 登录用户的实时数据全部落盘：后台线程每 storage/batchRows 行或每 storage/flushMs 毫秒写入一次；
+    // storage/streamBackend 为 "segments"（默认，段文件）或 "sqlite"（sensor_samples 表）
+    if (!m_username.isEmpty() && appSettings().value("storage/persistStream", true).toBool()) {
+        QStringList channelNames;
+        for (int channel = 0; channel < FrameDecoder::MaxChannels; ++channel) {
+            channelNames.append(channelInfo(channel).name);
+        }
+        StreamWriter::Backend backend = appSettings().value("storage/streamBackend", "segments").toString() == "sqlite"
+                                            ? StreamWriter::Backend::Sqlite : StreamWriter::Backend::Segments;
+        streamWriter = new StreamWriter(m_username, channelNames, backend,
+                                        appSettings().value("storage/batchRows", 2000).toInt(),
+                                        appSettings().value("storage/flushMs", 500).toInt());
+        connect(sessionManager, &DeviceSessionManager::samplesReceived, this, [this](int sessionId, const SampleBatch &samples) {
+            // 会话 id 只在本次运行内有效且会被复用，落盘按设备标识区分
+            DeviceSession *session = sessionManager->session(sessionId);
+            streamWriter->append(session ? session->deviceKey() : QString(), samples);
+        });
+    }
+
+    primarySession = sessionManager->createSession();
+
+    // 遥测每秒刷新一次状态栏
+    telemetry = new IngestTelemetry(sessionManager, 1000, this);
+    telemetryLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(telemetryLabel, 1);
+    connect(telemetry, &IngestTelemetry::updated, this, [this]() { telemetryLabel->setText(telemetry->summary()); });
+
+    connect(primarySession->device(), &BlueDevice::deviceDiscovered, this, &MainWindow::onDeviceDiscovered);
+
+    // 已缓存服务的设备直接列出，不用搜索即可连接
+    for (const CachedService &service : ServiceCache::instance().entries()) {
+        onDeviceDiscovered(QBluetoothDeviceInfo(service.address, service.name, 0));
+    }
+
+    // 配置了本地传输层（模拟器、伪终端、TCP、文件、抓包回放）时直接连接，不经过蓝牙搜索
+    // 可以用逗号分隔多个，每个占用一个会话
+    const QStringList transportSpecs = appSettings().value("ingest/transport").toStringList();
+    for (const QString &spec : transportSpecs) {
+        DeviceSession *session = sessionManager->idleSession();
+        if (!session) {
+            session = sessionManager->createSession();
+        }
+        session->connectToTransport(spec.trimmed());
+    }
+
+    // 没有配置本地传输层时，启动后自动连接上一次连上的设备，连不上按退避策略继续重试
+    if (transportSpecs.isEmpty() && appSettings().value("reconnect/atStartup", true).toBool()) {
+        const QList<CachedService> known = ServiceCache::instance().entries();
+        if (!known.isEmpty() && known.first().lastConnectedAt > 0) {
+            const CachedService &last = known.first();
+            qDebug() << "自动连接上次的设备:" << last.name << last.address.toString();
+            primarySession->connectToDevice(QBluetoothDeviceInfo(last.address, last.name, 0));
+        }
+    }
+}
+
+void MainWindow::configureSession(DeviceSession *session)
+{
+    connect(session, &DeviceSession::stateChanged, this, &MainWindow::onSessionStateChanged);
+    connect(session, &DeviceSession::channelCountDetected, this, &MainWindow::ensureChannelGraphs);
+    connect(session, &DeviceSession::resumed, this, &MainWindow::onSessionResumed);
+    ensureChannelGraphs(session->id(), 1); // 先添加通道 0 的曲线，其余通道在识别出通道数后添加
+
+    // 断线自动重连：首次等待 reconnect/initialMs，每次翻倍，最长 reconnect/maxMs
+    session->setReconnectPolicy(appSettings().value("reconnect/enabled", true).toBool(),
+                                appSettings().value("reconnect/initialMs", 500).toInt(),
+                                appSettings().value("reconnect/maxMs", 30000).toInt());
+
+    // JustFloat 通道数，默认 0 表示自动识别
+    int channelCount = appSettings().value("ingest/channels", 0).toInt();
+
+    // 配置了抓包文件时记录接收到的全部原始数据，相对路径放在数据目录下；会话 1 起在文件名后加编号
+    QString capturePath = appSettings().value("ingest/captureFile").toString();
+    if (!capturePath.isEmpty()) {
+        QFileInfo info(QDir(appDataDir()).absoluteFilePath(capturePath));
+        if (session->id() > 0) {
+            capturePath = info.dir().filePath(QString("%1-%2.%3").arg(info.completeBaseName()).arg(session->id()).arg(info.suffix()));
+        } else {
+            capturePath = info.absoluteFilePath();
+        }
+    }
+
+    session->invoke([device = session->device(), channelCount, capturePath]() {
+        device->setChannelCount(channelCount);
+        if (!capturePath.isEmpty()) {
+            device->setCaptureFile(capturePath);
+        }
+    });
+}
+
 void MainWindow::loadUserData()
 {
     if (m_username.isEmpty()) {
         return;
     }
 
-    // 获取用户最新的体重数据
-    double latestWeight = DatabaseManager::instance().getLatestWeight(m_username, 60.0); // 默认值60kg
+    // 一次查询取出用户最新的体重和百分比数据
+    const QHash<QString, double> latest = DatabaseManager::instance().getLatestMeasurements(m_username, {"weight", "percentage"});
+    double latestWeight = latest.value("weight", 60.0); // 默认值60kg
     ui->spinBox->setValue(static_cast<int>(latestWeight));
 
-    // 获取用户最新的百分比数据
-    double latestPercentage = DatabaseManager::instance().getLatestPercentage(m_username, 50.0); // 默认值50%
+    double latestPercentage = latest.value("percentage", 0.5); // 默认值50%
     ui->spinBox_2->setValue(static_cast<int>(latestPercentage*100));
 
     qDebug() << "已加载用户" << m_username << "的数据: 体重=" << latestWeight
@@ -52,21 +155,64 @@ void MainWindow::loadUserData()
 void MainWindow::onStartDiscoveryClicked()
 {
     ui->listWidget->clear();
-    blueDevice->startDiscovery();
+    mydevice.clear();
+    primarySession->invoke([device = primarySession->device()]() { device->startDiscovery(); });
 }
 
-void MainWindow::onConnectionEstablished()
+void MainWindow::onSessionStateChanged(int sessionId, DeviceSession::State state)
 {
-    setLED(ui->flag, 2, 16);
+    DeviceSession *session = sessionManager->session(sessionId);
+    if (state == DeviceSession::State::Connected) {
+        activeSession = session;
+    } else if (session == activeSession) {
+        // 当前设备断开，命令改发给其他仍在线的设备
+        activeSession = nullptr;
+        for (DeviceSession *other : sessionManager->sessions()) {
+            if (other->state() == DeviceSession::State::Connected) {
+                activeSession = other;
+                break;
+            }
+        }
+    }
+
+    // 任意一台设备在线即亮绿灯，都不在线但有设备在重连时亮黄灯
+    int led = 1;
+    if (sessionManager->connectedCount() > 0) {
+        led = 2;
+    } else {
+        for (DeviceSession *other : sessionManager->sessions()) {
+            if (other->state() == DeviceSession::State::Reconnecting) {
+                led = 3;
+                break;
+            }
+        }
+    }
+    setLED(ui->flag, led, 16);
 }
 
-void MainWindow::onConnectionLost()
+void MainWindow::onSessionResumed(int sessionId, double gapStart, double gapEnd)
 {
-    setLED(ui->flag, 1, 16);
+    // 时间轴不重置，重连后的数据接在原曲线后面；在断开时刻插入 NaN，曲线在中断区间断开
+    const QVector<QCPGraph *> graphs = sessionGraphs.value(sessionId);
+    for (QCPGraph *graph : graphs) {
+        graph->addData(gapStart - mTimeOffset, qQNaN());
+    }
+    // 落盘的数据同样标出中断，读取历史时不会在断线区间两端之间连一条直线
+    DeviceSession *session = sessionManager->session(sessionId);
+    if (streamWriter && session) {
+        streamWriter->appendGap(session->deviceKey(), gapStart, graphs.size());
+    }
+    qDebug() << "会话" << sessionId << "数据中断" << gapEnd - gapStart << "秒";
+    requestRender();
 }
 
 void MainWindow::onDeviceDiscovered(const QBluetoothDeviceInfo &device)
 {
+    for (const QBluetoothDeviceInfo &known : mydevice) {
+        if (known.address() == device.address()) {
+            return;
+        }
+    }
     ui->listWidget->addItem(device.name());
     mydevice.append(device);
 }
@@ -74,20 +220,42 @@ void MainWindow::onDeviceDiscovered(const QBluetoothDeviceInfo &device)
 void MainWindow::connectdevice()
 {
     int row = ui->listWidget->currentRow();
+    if (row < 0 || row >= mydevice.size()) {
+        return;
+    }
     const auto deviceInfo = mydevice.at(row);
-    blueDevice->connectToDevice(deviceInfo);
+
+    // 该设备已有会话时复用；否则用空闲会话，没有空闲会话时新建一个，与已连接的设备并行工作
+    DeviceSession *session = sessionManager->sessionFor(deviceInfo.address());
+    if (session && session->state() != DeviceSession::State::Idle) {
+        return;
+    }
+    if (!session) {
+        session = sessionManager->idleSession();
+    }
+    if (!session) {
+        session = sessionManager->createSession();
+    }
+    session->connectToDevice(deviceInfo);
 }
 
 void MainWindow::setplot()
 {
-    ui->myCustomPlot->addGraph(); // 添加一条曲线
-    ui->myCustomPlot->graph(0)->setPen(QPen(Qt::blue));
+    ui->myCustomPlot->legend->setVisible(true); // 每个会话、每个通道的曲线在会话创建后添加
 
     ui->myCustomPlot->xAxis->setLabel("Time (s)"); // 横轴以时间为刻度
     ui->myCustomPlot->yAxis->setLabel("Value");
 
-    double mLastTime = QDateTime::currentMSecsSinceEpoch() / 1000.0; // 初始化数据
+    double mLastTime = BlueDevice::clockTime(); // 初始化数据，与采样点时间戳同一个时钟
     mTimeOffset = mLastTime;
+
+    // 曲线只保留最近 plot/retentionSeconds 秒（不少于显示的 10 秒）；plot/retentionSamples 大于 0 时每条曲线另限点数
+    // 长时间运行时曲线的内存占用保持不变
+    retentionSeconds = appSettings().value("plot/retentionSeconds", 60.0).toDouble();
+    if (retentionSeconds > 0) {
+        retentionSeconds = qMax(retentionSeconds, 10.0);
+    }
+    retentionSamples = appSettings().value("plot/retentionSamples", 0).toInt();
 }
 
 QList<QByteArray> senddata = {"ss", "sf", "sb", "sl", "sr", "sr"};
@@ -97,7 +265,8 @@ void MainWindow::setbutton()
     // 按下前进按钮时发送 "forward"
     connect(ui->front_button, &QPushButton::pressed, this, [this](){
         qDebug() << "forward";
-        blueDevice->sendData(senddata[1]);
+        DeviceSession *target = activeSession ? activeSession : primarySession;
+        target->sendData(senddata[1]);
     });
     // 松开前进按钮时发送 "stop"
     connect(ui->front_button, &QPushButton::released, this, [this](){
@@ -157,28 +326,191 @@ void MainWindow::setspinbox()
     });
 }
 
-float Byte_to_Float(const QByteArray &data) {
-    float value;
-    if(data.length() == 4)
-    {
-        memcpy(&value, data, 4);
-        return value;
+void MainWindow::ensureChannelGraphs(int sessionId, int count)
+{
+    QVector<QCPGraph *> &graphs = sessionGraphs[sessionId];
+
+    // 通道 0（体重）使用左侧纵轴，其余通道共用右侧纵轴，避免量纲不同的曲线互相压扁
+    // 多台设备时按会话旋转色相并在图例前加编号
+    while (graphs.size() < count) {
+        int channel = graphs.size();
+        ChannelInfo info = channelInfo(channel);
+        QCPAxis *valueAxis = channel == 0 ? ui->myCustomPlot->yAxis : ui->myCustomPlot->yAxis2;
+        if (channel > 0) {
+            ui->myCustomPlot->yAxis2->setVisible(true);
+        }
+
+        QColor color = info.color;
+        QString name = info.label;
+        if (sessionId > 0) {
+            color.setHsv((color.hsvHue() + 47 * sessionId) % 360, color.hsvSaturation(), color.value());
+            name = QString("#%1 %2").arg(sessionId + 1).arg(info.label);
+        }
+
+        QCPGraph *graph = ui->myCustomPlot->addGraph(ui->myCustomPlot->xAxis, valueAxis);
+        graph->setPen(QPen(color));
+        graph->setName(name);
+        graphs.append(graph);
+    }
+}
+
+void MainWindow::removeSessionGraphs(int sessionId)
+{
+    for (QCPGraph *graph : sessionGraphs.take(sessionId)) {
+        ui->myCustomPlot->removeGraph(graph);
+    }
+    valueRanges.remove(sessionId);
+    requestRender();
+}
+
+void MainWindow::updateData(int sessionId, const SampleBatch &samples)
+{
+    if (samples.isEmpty()) {
+        return;
+    }
+
+    // 按通道拆分，每个通道的曲线整批追加一次；这里只追加数据，重绘由渲染时钟完成
+    QVector<QCPGraph *> &graphs = sessionGraphs[sessionId];
+    QVector<QVector<double>> keys(graphs.size()), values(graphs.size());
+    ValueRanges &ranges = valueRanges[sessionId]; // 纵轴自动缩放用的滑动窗口
+    for (const Sample &sample : samples) {
+        if (plottedStamps.isEmpty() || plottedStamps.last() != sample.timestamp) {
+            plottedStamps.append(sample.timestamp); // 同一次读取的采样点时间戳相同
+        }
+        if (sample.channel >= graphs.size()) {
+            ensureChannelGraphs(sessionId, sample.channel + 1);
+            keys.resize(graphs.size());
+            values.resize(graphs.size());
+        }
+        keys[sample.channel].append(sample.timestamp - mTimeOffset);
+        values[sample.channel].append(sample.value);
+        // 按采样顺序追加，保证横坐标不减；通道 0 在左侧纵轴，其余通道在右侧纵轴
+        (sample.channel == 0 ? ranges.left : ranges.right).append(sample.timestamp - mTimeOffset, sample.value);
+    }
+
+    latestTime = qMax(latestTime, samples.last().timestamp - mTimeOffset);
+
+    for (int channel = 0; channel < graphs.size(); ++channel) {
+        if (!keys[channel].isEmpty()) {
+            graphs[channel]->addData(keys[channel], values[channel], true); // 整批追加到曲线
+            evictOldData(graphs[channel]);
+        }
+    }
+
+    requestRender();
+}
+
+void MainWindow::evictOldData(QCPGraph *graph)
+{
+    // removeBefore 只移动数据容器的起点，被移出的空间在积累到一定量后才一次性回收，摊还 O(1)
+    QSharedPointer<QCPGraphDataContainer> data = graph->data();
+    if (retentionSeconds > 0 && !data->isEmpty()) {
+        double cutoff = latestTime - retentionSeconds;
+        if (data->constBegin()->key < cutoff) {
+            data->removeBefore(cutoff);
+        }
+    }
+    if (retentionSamples > 0 && data->size() > retentionSamples) {
+        data->removeBefore(data->at(data->size() - retentionSamples)->key);
+    }
+}
+
+void MainWindow::autoscaleValueAxes(double windowStart)
+{
+    // 各会话的滑动窗口先淘汰移出可见范围的点，再合并出每个纵轴的数据范围，不遍历曲线数据
+    bool hasLeft = false, hasRight = false;
+    double leftLow = 0, leftHigh = 0, rightLow = 0, rightHigh = 0;
+    for (ValueRanges &ranges : valueRanges) {
+        ranges.left.evictBefore(windowStart);
+        ranges.right.evictBefore(windowStart);
+        if (!ranges.left.isEmpty()) {
+            leftLow = hasLeft ? qMin(leftLow, ranges.left.min()) : ranges.left.min();
+            leftHigh = hasLeft ? qMax(leftHigh, ranges.left.max()) : ranges.left.max();
+            hasLeft = true;
+        }
+        if (!ranges.right.isEmpty()) {
+            rightLow = hasRight ? qMin(rightLow, ranges.right.min()) : ranges.right.min();
+            rightHigh = hasRight ? qMax(rightHigh, ranges.right.max()) : ranges.right.max();
+            hasRight = true;
+        }
+    }
+
+    const QPair<QCPAxis *, bool> axes[] = {{ui->myCustomPlot->yAxis, hasLeft}, {ui->myCustomPlot->yAxis2, hasRight}};
+    for (const auto &axis : axes) {
+        if (!axis.second) {
+            continue;
+        }
+        double lower = axis.first->range().lower;
+        double upper = axis.first->range().upper;
+        bool left = axis.first == ui->myCustomPlot->yAxis;
+        if (axisHysteresis.update(left ? leftLow : rightLow, left ? leftHigh : rightHigh, lower, upper)) {
+            axis.first->setRange(lower, upper);
+        }
+    }
+}
+
+void MainWindow::setupRenderClock()
+{
+    // plot/fps 为目标帧率；0 表示不用定时器，数据到达后在事件循环空闲时合并重绘一次
+    int fps = appSettings().value("plot/fps", 30).toInt();
+    if (fps > 0) {
+        renderTimer.setTimerType(Qt::PreciseTimer);
+        connect(&renderTimer, &QTimer::timeout, this, &MainWindow::renderPlot);
+        renderTimer.start(qMax(1, 1000 / fps));
     }
-    else
-        return 0;
+
+    // 左上角显示实际帧率和被合并掉的更新次数
+    renderStatsText = new QCPItemText(ui->myCustomPlot);
+    renderStatsText->setPositionAlignment(Qt::AlignLeft | Qt::AlignTop);
+    renderStatsText->position->setType(QCPItemPosition::ptAxisRectRatio);
+    renderStatsText->position->setCoords(0.01, 0.01);
+    renderStatsText->setColor(Qt::gray);
+    renderStatsText->setText(fps > 0 ? QString("目标 %1 fps").arg(fps) : QString("按需重绘"));
+    renderStatsClock.start();
 }
 
-void MainWindow::updateData(const QByteArray &data)
+void MainWindow::requestRender()
 {
-    double currentTime = QDateTime::currentMSecsSinceEpoch() / 1000.0 - mTimeOffset;
-    float value = Byte_to_Float(data); // 模拟数据，可改成真实采集值
+    if (plotDirty) {
+        ++skippedUpdates; // 上一次更新还没画出来，本次与之合并
+    }
+    plotDirty = true;
 
-    ui->myCustomPlot->graph(0)->addData(currentTime, value); // 向曲线追加数据
+    if (!renderTimer.isActive() && !renderQueued) {
+        renderQueued = true;
+        QMetaObject::invokeMethod(this, &MainWindow::renderPlot, Qt::QueuedConnection);
+    }
+}
 
-    ui->myCustomPlot->xAxis->setRange(currentTime, 10, Qt::AlignRight);  // 仅显示最近 10 秒的数据
-    ui->myCustomPlot->graph(0)->rescaleValueAxis(true);
+void MainWindow::renderPlot()
+{
+    renderQueued = false;
+    if (!plotDirty) {
+        return;
+    }
+    plotDirty = false;
+
+    ui->myCustomPlot->xAxis->setRange(latestTime, 10, Qt::AlignRight);  // 仅显示最近 10 秒的数据
+    autoscaleValueAxes(latestTime - 10);
+
+    // 每秒更新一次帧率显示
+    ++renderedFrames;
+    qint64 elapsed = renderStatsClock.elapsed();
+    if (elapsed >= 1000) {
+        achievedFps = renderedFrames * 1000.0 / elapsed;
+        renderStatsText->setText(QString("%1 fps  合并更新 %2").arg(achievedFps, 0, 'f', 1).arg(skippedUpdates));
+        renderedFrames = 0;
+        renderStatsClock.restart();
+    }
 
     ui->myCustomPlot->replot(); // 刷新图表
+
+    // 接收到绘图的延迟：每次读取记录一次
+    double plottedAt = BlueDevice::clockTime();
+    for (double stamp : plottedStamps) {
+        telemetry->recordPlotLatency((plottedAt - stamp) * 1000.0);
+    }
+    plottedStamps.resize(0);
 }
 
 void MainWindow::setLED(QLabel* label, int color, int size)
@@ -7,8 +7,13 @@
 #include <QTimer>
 #include <QDateTime>
 #include <QLabel>
-#include "bluetooth.h"
+#include <QHash>
+#include "devicesession.h"
 #include "databasemanager.h"
+#include "channels.h"
+#include "telemetry.h"
+#include "rollingrange.h"
+#include "streamwriter.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -24,9 +29,49 @@ public:
     MainWindow(const QString& username = QString(), QWidget *parent = nullptr);
     ~MainWindow();
 
+    size_t ingestRingOccupancy() const { return sessionManager->ringOccupancy(); } // 所有会话环形缓冲区当前占用
+    quint64 ingestRingOverflow() const { return sessionManager->ringOverflow(); } // 因缓冲区写满丢弃的采样点数
+    TelemetrySnapshot ingestTelemetry() const { return telemetry->snapshot(); } // 最近一秒的帧率、丢弃和延迟统计
+    double renderFps() const { return achievedFps; } // 最近一秒实际的重绘帧率
+    quint64 renderSkippedUpdates() const { return skippedUpdates; } // 合并掉的数据更新次数
+
 private:
     Ui::MainWindow *ui;
-    BlueDevice *blueDevice; // 蓝牙设备处理对象
+    DeviceSessionManager *sessionManager; // 并发设备会话，每个会话有独立的采集线程和队列
+    DeviceSession *primarySession; // 会话 0，负责设备搜索
+    DeviceSession *activeSession = nullptr; // 方向按钮的命令发往最近连接上的设备
+    IngestTelemetry *telemetry; // 采集链路遥测，显示在状态栏
+    StreamWriter *streamWriter = nullptr; // 登录用户的实时数据落盘
+    QLabel *telemetryLabel;
+    QVector<double> plottedStamps; // 自上次重绘以来的接收时间戳，画出后记录接收到绘图的延迟
+
+    // 渲染时钟：数据到达只追加并标记需要重绘，按目标帧率统一重绘，重绘开销与采样率无关
+    void setupRenderClock();
+    void requestRender(); // 标记需要重绘
+    void renderPlot();
+    QTimer renderTimer;
+    bool plotDirty = false;
+    bool renderQueued = false;
+    double latestTime = 0; // 所有会话最新采样点的横坐标
+    QElapsedTimer renderStatsClock;
+    int renderedFrames = 0;
+    double achievedFps = 0;
+    quint64 skippedUpdates = 0; // 被合并、没有单独重绘的数据更新次数
+    QCPItemText *renderStatsText = nullptr;
+
+    void evictOldData(QCPGraph *graph); // 按保留策略丢弃曲线上过旧的点
+    double retentionSeconds = 60; // 曲线保留的时长，0 表示不限
+    int retentionSamples = 0; // 每条曲线保留的点数，0 表示不限
+
+    // 纵轴增量自动缩放：每个会话按纵轴维护可见窗口内的最小值/最大值，重绘时合并，带滞回
+    struct ValueRanges
+    {
+        RollingRange left;  // 通道 0，左侧纵轴
+        RollingRange right; // 其余通道，右侧纵轴
+    };
+    QHash<int, ValueRanges> valueRanges;
+    AxisHysteresis axisHysteresis;
+    void autoscaleValueAxes(double windowStart);
     QList<QBluetoothDeviceInfo> mydevice;
     double mTimeOffset;
     void setLED(QLabel* label, int color, int size);
@@ -40,12 +85,19 @@ private:
     QString m_username;
     void loadUserData();
 
+    void setupSessions();
+
+    QHash<int, QVector<QCPGraph *>> sessionGraphs; // 每个会话的每个通道一条曲线
+
 private slots:
     void onStartDiscoveryClicked(); // 开始设备发现
-    void onConnectionEstablished(); // 连接成功
-    void onConnectionLost(); // 连接断开
+    void configureSession(DeviceSession *session); // 新会话：设置通道数、抓包并连接信号
+    void onSessionStateChanged(int sessionId, DeviceSession::State state); // 会话连接状态变化
+    void onSessionResumed(int sessionId, double gapStart, double gapEnd); // 断线重连后在曲线和落盘数据中标出中断区间
+    void removeSessionGraphs(int sessionId);
     void onDeviceDiscovered(const QBluetoothDeviceInfo &device); // 发现设备
     void connectdevice();
-    void updateData(const QByteArray &data);
+    void updateData(int sessionId, const SampleBatch &samples);
+    void ensureChannelGraphs(int sessionId, int count); // 确保会话的前 count 个通道都有曲线
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,83 @@
+#ifndef ROLLINGRANGE_H
+#define ROLLINGRANGE_H
+
+#include <QtGlobal>
+#include <cmath>
+#include <deque>
+
+// 滑动窗口最小值/最大值：两个单调队列，按横坐标追加、按横坐标淘汰，每个点摊还 O(1)
+// 追加的横坐标须不减；NaN（曲线断开标记）不参与统计
+class RollingRange
+{
+public:
+    void append(double key, double value)
+    {
+        if (std::isnan(value)) {
+            return;
+        }
+        // 队尾比新值大（小）的点再也不会成为最小值（最大值），直接出队
+        while (!m_min.empty() && m_min.back().value >= value) {
+            m_min.pop_back();
+        }
+        m_min.push_back({key, value});
+        while (!m_max.empty() && m_max.back().value <= value) {
+            m_max.pop_back();
+        }
+        m_max.push_back({key, value});
+    }
+
+    void evictBefore(double key) // 丢弃横坐标小于 key 的点
+    {
+        while (!m_min.empty() && m_min.front().key < key) {
+            m_min.pop_front();
+        }
+        while (!m_max.empty() && m_max.front().key < key) {
+            m_max.pop_front();
+        }
+    }
+
+    bool isEmpty() const { return m_min.empty(); }
+    double min() const { return m_min.front().value; } // 窗口非空时有效
+    double max() const { return m_max.front().value; }
+
+    void clear()
+    {
+        m_min.clear();
+        m_max.clear();
+    }
+
+private:
+    struct Point
+    {
+        double key;
+        double value;
+    };
+
+    std::deque<Point> m_min; // 值单调递增
+    std::deque<Point> m_max; // 值单调递减
+};
+
+// 纵轴自动缩放的滞回：数据超出当前范围时放大并留出余量，数据只占当前范围一小部分时才缩小，
+// 避免每帧微小波动都改动坐标轴
+struct AxisHysteresis
+{
+    double margin = 0.1;       // 放大时上下各留出数据跨度的这一比例
+    double shrinkBelow = 0.4;  // 数据跨度小于当前范围的这一比例时缩小
+
+    // 根据窗口内的数据范围 [low, high] 计算新的坐标轴范围，不需要改动时返回 false
+    bool update(double low, double high, double &axisLower, double &axisUpper) const
+    {
+        double span = high - low;
+        double pad = span > 0 ? span * margin : qMax(std::abs(high) * margin, 1e-6);
+        bool outside = low < axisLower || high > axisUpper;
+        bool tooLoose = axisUpper - axisLower > 0 && span < (axisUpper - axisLower) * shrinkBelow;
+        if (!outside && !tooLoose) {
+            return false;
+        }
+        axisLower = low - pad;
+        axisUpper = high + pad;
+        return true;
+    }
+};
+
+#endif // ROLLINGRANGE_H
@@ -0,0 +1,20 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <QVector>
+#include <QMetaType>
+
+// 一个解码后的采样点：接收时间（自 epoch 起的秒数）、数值和所属通道（JustFloat 帧中的第几个 float）
+struct Sample
+{
+    double timestamp;
+    double value;
+    int channel = 0;
+};
+
+// 一次 readyRead 解码出的全部采样点，连续存放
+using SampleBatch = QVector<Sample>;
+
+Q_DECLARE_METATYPE(SampleBatch)
+
+#endif // SAMPLE_H
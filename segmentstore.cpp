@@ -0,0 +1,590 @@
+#include "segmentstore.h"
+#include "appsettings.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QUrl>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const char kSegmentMagic[8] = {'R', 'C', 'T', 'S', 'S', 'E', 'G', '\0'};
+static const char kIndexMagic[8] = {'R', 'C', 'T', 'S', 'I', 'D', 'X', '\0'};
+static const quint32 kSegmentVersion = 1;
+static const char* const kIndexFile = "/segments.idx";
+
+// segments.idx 中一个已封存段的元数据，文件头（magic、版本、条目数）之后依次存放
+struct SegmentIndexEntry
+{
+    quint32 sequence;
+    quint32 count;
+    double firstTimestamp;
+    double lastTimestamp;
+};
+
+static_assert(sizeof(SegmentRecord) == 16, "段记录必须是紧凑的 16 字节");
+static_assert(sizeof(SegmentIndexEntry) == 24, "段索引条目必须是紧凑的 24 字节");
+
+static bool recordBefore(const SegmentRecord& record, double t)
+{
+    return record.timestamp < t;
+}
+
+static bool timeBefore(double t, const SegmentRecord& record)
+{
+    return t < record.timestamp;
+}
+
+SegmentStore::SegmentStore()
+{
+    m_root = appDataDir() + "/segments";
+    static_assert(sizeof(SegmentHeader) == 64, "段文件头必须是 64 字节");
+}
+
+SegmentStore::~SegmentStore()
+{
+    close();
+}
+
+SegmentStore& SegmentStore::instance()
+{
+    static SegmentStore instance;
+    return instance;
+}
+
+QString SegmentStore::encodeName(const QString& name)
+{
+    // 用户名、设备标识和通道名可能含有路径分隔符或冒号，按 URL 规则转义后作为目录名
+    return name.isEmpty() ? QString("_") : QString::fromLatin1(QUrl::toPercentEncoding(name));
+}
+
+QString SegmentStore::seriesDir(const QString& username, const QString& device, const QString& channel) const
+{
+    return m_root + "/" + encodeName(username) + "/" + encodeName(device) + "/" + encodeName(channel);
+}
+
+QString SegmentStore::segmentPath(const Series* series, int sequence) const
+{
+    return series->dir + QString("/%1.seg").arg(sequence, 8, 10, QChar('0'));
+}
+
+SegmentStore::Series* SegmentStore::series(const QString& username, const QString& device, const QString& channel, bool create)
+{
+    const QString dir = seriesDir(username, device, channel);
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_series.constFind(dir);
+    if (it != m_series.constEnd()) {
+        return it.value();
+    }
+    if (!create && !QFileInfo::exists(dir)) {
+        return nullptr;
+    }
+    if (!QDir().mkpath(dir)) {
+        qDebug() << "无法创建段目录:" << dir;
+        return nullptr;
+    }
+
+    Series* result = new Series;
+    result->dir = dir;
+    loadSeries(result);
+    m_series.insert(dir, result);
+    return result;
+}
+
+void SegmentStore::loadSeries(Series* series)
+{
+    // 已封存段的条数和首末时间来自 segments.idx，不打开段文件
+    QHash<int, SegmentIndexEntry> indexed;
+    QFile index(series->dir + kIndexFile);
+    if (index.open(QIODevice::ReadOnly)) {
+        char magic[8];
+        quint32 version = 0;
+        quint32 entries = 0;
+        if (index.read(magic, sizeof(magic)) == qint64(sizeof(magic)) && memcmp(magic, kIndexMagic, sizeof(magic)) == 0
+            && index.read(reinterpret_cast<char*>(&version), sizeof(version)) == qint64(sizeof(version))
+            && version == kSegmentVersion
+            && index.read(reinterpret_cast<char*>(&entries), sizeof(entries)) == qint64(sizeof(entries))) {
+            for (quint32 i = 0; i < entries; ++i) {
+                SegmentIndexEntry entry;
+                if (index.read(reinterpret_cast<char*>(&entry), sizeof(entry)) != qint64(sizeof(entry))) {
+                    break;
+                }
+                indexed.insert(int(entry.sequence), entry);
+            }
+        } else {
+            qDebug() << "段索引无效，改为读取各段文件头:" << index.fileName();
+        }
+    }
+
+    // 段文件名是递增的序号，按文件名排序即按写入顺序排序
+    bool indexChanged = false;
+    const QStringList files = QDir(series->dir).entryList({"*.seg"}, QDir::Files, QDir::Name);
+    for (const QString& file : files) {
+        const int sequence = QFileInfo(file).baseName().toInt();
+        series->nextSequence = qMax(series->nextSequence, sequence + 1); // 无效的段也不覆盖
+
+        auto segment = std::make_unique<Segment>();
+        segment->sequence = sequence;
+        auto it = indexed.constFind(sequence);
+        if (it != indexed.constEnd()) {
+            segment->count = it->count;
+            segment->firstTimestamp = it->firstTimestamp;
+            segment->lastTimestamp = it->lastTimestamp;
+            segment->sealed = true;
+        } else {
+            // 不在索引中的段：上次正在写入的段，或封存后还没来得及写进索引的段，只读一次文件头
+            SegmentHeader header;
+            if (!readHeader(segmentPath(series, sequence), &header)) {
+                qDebug() << "跳过无效的段文件:" << segmentPath(series, sequence);
+                continue;
+            }
+            segment->count = header.count;
+            segment->firstTimestamp = header.firstTimestamp;
+            segment->lastTimestamp = header.lastTimestamp;
+            segment->sealed = header.count >= header.capacity;
+            indexChanged |= segment->sealed;
+        }
+        series->segments.push_back(std::move(segment));
+    }
+
+    // 只有序号最大的未写满段继续写入，其余的按已封存处理
+    for (size_t i = 0; i + 1 < series->segments.size(); ++i) {
+        if (!series->segments[i]->sealed) {
+            series->segments[i]->sealed = true;
+            indexChanged = true;
+        }
+    }
+    if (indexChanged) {
+        saveIndex(series);
+    }
+}
+
+bool SegmentStore::readHeader(const QString& path, SegmentHeader* header) const
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly)
+        && file.read(reinterpret_cast<char*>(header), sizeof(SegmentHeader)) == qint64(sizeof(SegmentHeader))
+        && memcmp(header->magic, kSegmentMagic, sizeof(kSegmentMagic)) == 0 && header->version == kSegmentVersion
+        && header->capacity > 0 && header->count <= header->capacity
+        && file.size() >= qint64(sizeof(SegmentHeader)) + qint64(header->count) * qint64(sizeof(SegmentRecord));
+}
+
+bool SegmentStore::saveIndex(const Series* series) const
+{
+    QVector<SegmentIndexEntry> entries;
+    for (const auto& segment : series->segments) {
+        if (segment->sealed) {
+            entries.append(SegmentIndexEntry{quint32(segment->sequence), quint32(segment->count),
+                                             segment->firstTimestamp, segment->lastTimestamp});
+        }
+    }
+
+    // 整个文件重写后原子替换，写到一半退出时保留旧索引
+    QSaveFile file(series->dir + kIndexFile);
+    const quint32 version = kSegmentVersion;
+    const quint32 count = quint32(entries.size());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "无法写入段索引:" << file.fileName() << file.errorString();
+        return false;
+    }
+    file.write(kIndexMagic, sizeof(kIndexMagic));
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char*>(entries.constData()), qint64(entries.size()) * qint64(sizeof(SegmentIndexEntry)));
+    if (!file.commit()) {
+        qDebug() << "无法写入段索引:" << file.fileName() << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool SegmentStore::mapActive(Series* series, Segment* segment, bool create)
+{
+    const qint64 fullSize = qint64(sizeof(SegmentHeader)) + qint64(RecordsPerSegment) * qint64(sizeof(SegmentRecord));
+    segment->file.setFileName(segmentPath(series, segment->sequence));
+    if (!segment->file.open(QIODevice::ReadWrite) || (create && !segment->file.resize(fullSize))) {
+        qDebug() << "无法打开段文件:" << segment->file.fileName() << segment->file.errorString();
+        segment->file.close();
+        return false;
+    }
+
+    // 映射建立后关闭文件，不长期占用文件描述符
+    const qint64 size = create ? fullSize : segment->file.size();
+    segment->map = segment->file.map(0, size);
+    segment->file.close();
+    if (!segment->map) {
+        qDebug() << "无法映射段文件:" << segment->file.fileName() << segment->file.errorString();
+        return false;
+    }
+
+    SegmentHeader* header = segment->header();
+    if (create) {
+        memset(header, 0, sizeof(SegmentHeader));
+        memcpy(header->magic, kSegmentMagic, sizeof(kSegmentMagic));
+        header->version = kSegmentVersion;
+        header->capacity = RecordsPerSegment;
+    } else if (size < qint64(sizeof(SegmentHeader)) + qint64(header->capacity) * qint64(sizeof(SegmentRecord))) {
+        // 提前封存时被截短过的段不能再写
+        segment->file.unmap(segment->map);
+        segment->map = nullptr;
+        return false;
+    }
+    series->active = segment;
+    return true;
+}
+
+SegmentStore::Segment* SegmentStore::writableSegment(Series* series)
+{
+    if (!series->active && !series->segments.empty() && !series->segments.back()->sealed) {
+        // 上次没写满的段继续写
+        Segment* last = series->segments.back().get();
+        if (!mapActive(series, last, false)) {
+            last->sealed = true;
+            saveIndex(series);
+        }
+    }
+
+    Segment* active = series->active;
+    if (active && active->count < active->header()->capacity) {
+        return active;
+    }
+    if (active) {
+        seal(series);
+    }
+
+    auto segment = std::make_unique<Segment>();
+    segment->sequence = series->nextSequence++;
+    Segment* created = segment.get();
+    series->segments.push_back(std::move(segment));
+    if (!mapActive(series, created, true)) {
+        series->segments.pop_back();
+        return nullptr;
+    }
+    return created;
+}
+
+void SegmentStore::seal(Series* series)
+{
+    Segment* segment = series->active;
+    if (!segment) {
+        return;
+    }
+    series->active = nullptr;
+    segment->file.unmap(segment->map);
+    segment->map = nullptr;
+    segment->sealed = true;
+
+    // 没写满就封存的段（时钟回拨后另起新段）截掉未用的尾部
+    const qint64 used = qint64(sizeof(SegmentHeader)) + qint64(segment->count) * qint64(sizeof(SegmentRecord));
+    if (segment->count < quint64(RecordsPerSegment) && !QFile::resize(segment->file.fileName(), used)) {
+        qDebug() << "无法截短段文件:" << segment->file.fileName();
+    }
+    saveIndex(series);
+}
+
+const SegmentRecord* SegmentStore::mapForRead(Series* series, Segment* segment)
+{
+    segment->lastUsed = ++series->useClock;
+    if (segment->map) {
+        return segment->records();
+    }
+
+    if (series->mappedSealed >= MaxMappedSegments) {
+        Segment* oldest = nullptr;
+        for (const auto& candidate : series->segments) {
+            if (candidate->map && candidate.get() != series->active
+                && (!oldest || candidate->lastUsed < oldest->lastUsed)) {
+                oldest = candidate.get();
+            }
+        }
+        if (oldest) {
+            unmap(series, oldest);
+        }
+    }
+
+    // 只映射已写入的部分，映射后即关闭文件
+    const qint64 size = qint64(sizeof(SegmentHeader)) + qint64(segment->count) * qint64(sizeof(SegmentRecord));
+    segment->file.setFileName(segmentPath(series, segment->sequence));
+    if (!segment->file.open(QIODevice::ReadOnly)) {
+        qDebug() << "无法打开段文件:" << segment->file.fileName() << segment->file.errorString();
+        return nullptr;
+    }
+    segment->map = segment->file.map(0, size);
+    segment->file.close();
+    if (!segment->map) {
+        qDebug() << "无法映射段文件:" << segment->file.fileName() << segment->file.errorString();
+        return nullptr;
+    }
+    ++series->mappedSealed;
+    return segment->records();
+}
+
+void SegmentStore::unmap(Series* series, Segment* segment)
+{
+    if (!segment->map) {
+        return;
+    }
+    segment->file.unmap(segment->map);
+    segment->map = nullptr;
+    if (segment != series->active) {
+        --series->mappedSealed;
+    }
+}
+
+int SegmentStore::append(const QString& username, const QString& device, const QString& channel, const QVector<Sample>& samples)
+{
+    if (samples.isEmpty()) {
+        return 0;
+    }
+
+    int rejected = 0;
+    Series* target = series(username, device, channel, true);
+    if (!target) {
+        rejected = samples.size();
+    } else {
+        QMutexLocker locker(&target->mutex);
+        int i = 0;
+        while (i < samples.size()) {
+            if (std::isnan(samples.at(i).timestamp)) {
+                ++rejected;
+                ++i;
+                continue;
+            }
+            Segment* segment = writableSegment(target);
+            if (!segment) {
+                rejected += samples.size() - i;
+                break;
+            }
+
+            // 记录直接写进映射内存；这一批写完后才更新文件头中的条数
+            SegmentHeader* header = segment->header();
+            SegmentRecord* records = segment->records();
+            const quint64 start = segment->count;
+            quint64 count = start;
+            bool backwards = false;
+            for (; i < samples.size() && count < header->capacity; ++i) {
+                const Sample& sample = samples.at(i);
+                if (std::isnan(sample.timestamp)) {
+                    ++rejected;
+                    continue;
+                }
+                if (count > 0 && sample.timestamp < segment->lastTimestamp) {
+                    backwards = true; // 段内必须有序：时间倒退时封存当前段，从这一条起写进新段
+                    break;
+                }
+                if (count == 0) {
+                    segment->firstTimestamp = sample.timestamp;
+                }
+                records[count++] = SegmentRecord{sample.timestamp, sample.value};
+                segment->lastTimestamp = sample.timestamp;
+            }
+            if (count > start) {
+                header->firstTimestamp = segment->firstTimestamp;
+                header->lastTimestamp = segment->lastTimestamp;
+                header->count = count;
+                segment->count = count;
+            }
+            if (backwards) {
+                seal(target);
+            }
+        }
+    }
+
+    if (rejected > 0) {
+        QMutexLocker storeLocker(&m_mutex);
+        m_rejected += quint64(rejected);
+    }
+    return rejected;
+}
+
+QVector<SegmentStore::Segment*> SegmentStore::overlapping(Series* series, double from, double to) const
+{
+    // 只看元数据挑出与范围相交的段，其余的段不打开；按首个时间排序
+    QVector<Segment*> hits;
+    for (const auto& segment : series->segments) {
+        if (segment->count > 0 && segment->firstTimestamp <= to && segment->lastTimestamp >= from) {
+            hits.append(segment.get());
+        }
+    }
+    std::stable_sort(hits.begin(), hits.end(), [](const Segment* a, const Segment* b) {
+        return a->firstTimestamp < b->firstTimestamp;
+    });
+    return hits;
+}
+
+bool SegmentStore::visitRange(Series* series, double from, double to, const RecordCallback& callback)
+{
+    for (Segment* segment : overlapping(series, from, to)) {
+        const SegmentRecord* records = mapForRead(series, segment);
+        if (!records) {
+            return false;
+        }
+        const int count = int(segment->count);
+        const SegmentRecord* begin = segment->firstTimestamp >= from
+            ? records : std::lower_bound(records, records + count, from, recordBefore);
+        const SegmentRecord* end = segment->lastTimestamp <= to
+            ? records + count : std::upper_bound(begin, records + count, to, timeBefore);
+        if (end > begin && !callback(begin, int(end - begin))) {
+            break;
+        }
+    }
+    return true;
+}
+
+qint64 SegmentStore::countUpperBound(Series* series, double from, double to) const
+{
+    qint64 total = 0;
+    for (const Segment* segment : overlapping(series, from, to)) {
+        total += qint64(segment->count);
+    }
+    return total;
+}
+
+bool SegmentStore::forEachRange(const QString& username, const QString& device, const QString& channel, qint64 fromMs, qint64 toMs,
+                                const RecordCallback& callback)
+{
+    Series* source = series(username, device, channel, false);
+    if (!source) {
+        return true; // 没有数据
+    }
+    QMutexLocker locker(&source->mutex);
+    return visitRange(source, fromMs / 1000.0, toMs / 1000.0, callback);
+}
+
+bool SegmentStore::getSeries(const QString& username, const QString& device, const QString& channel, qint64 fromMs, qint64 toMs,
+                             QVector<double>& keys, QVector<double>& values)
+{
+    Series* source = series(username, device, channel, false);
+    if (!source) {
+        return true;
+    }
+    QMutexLocker locker(&source->mutex);
+    const double from = fromMs / 1000.0;
+    const double to = toMs / 1000.0;
+
+    // 按元数据估计的条数一次分配到位，然后从映射内存顺序拷贝
+    const int base = keys.size();
+    const qint64 estimate = countUpperBound(source, from, to);
+    keys.reserve(base + int(estimate));
+    values.reserve(values.size() + int(estimate));
+
+    bool sorted = true;
+    double lastKey = -std::numeric_limits<double>::infinity();
+    bool ok = visitRange(source, from, to, [&](const SegmentRecord* records, int count) {
+        sorted = sorted && records[0].timestamp >= lastKey;
+        lastKey = records[count - 1].timestamp;
+        for (int i = 0; i < count; ++i) {
+            keys.append(records[i].timestamp);
+            values.append(records[i].value);
+        }
+        return true;
+    });
+
+    // 时钟回拨产生的段与其他段重叠时，合并后重新排序
+    if (!sorted) {
+        const int valueBase = values.size() - (keys.size() - base);
+        QVector<SegmentRecord> merged;
+        merged.reserve(keys.size() - base);
+        for (int i = base; i < keys.size(); ++i) {
+            merged.append(SegmentRecord{keys.at(i), values.at(valueBase + i - base)});
+        }
+        std::stable_sort(merged.begin(), merged.end(), [](const SegmentRecord& a, const SegmentRecord& b) {
+            return a.timestamp < b.timestamp;
+        });
+        for (int i = 0; i < merged.size(); ++i) {
+            keys[base + i] = merged.at(i).timestamp;
+            values[valueBase + i] = merged.at(i).value;
+        }
+    }
+    return ok;
+}
+
+QVector<Sample> SegmentStore::getSamples(const QString& username, const QString& device, const QString& channel,
+                                         qint64 fromMs, qint64 toMs)
+{
+    QVector<Sample> results;
+    Series* source = series(username, device, channel, false);
+    if (!source) {
+        return results;
+    }
+    QMutexLocker locker(&source->mutex);
+    const double from = fromMs / 1000.0;
+    const double to = toMs / 1000.0;
+
+    results.reserve(int(countUpperBound(source, from, to)));
+    bool sorted = true;
+    double lastKey = -std::numeric_limits<double>::infinity();
+    visitRange(source, from, to, [&](const SegmentRecord* records, int count) {
+        sorted = sorted && records[0].timestamp >= lastKey;
+        lastKey = records[count - 1].timestamp;
+        for (int i = 0; i < count; ++i) {
+            results.append(Sample{records[i].timestamp, records[i].value});
+        }
+        return true;
+    });
+    if (!sorted) {
+        std::stable_sort(results.begin(), results.end(), [](const Sample& a, const Sample& b) {
+            return a.timestamp < b.timestamp;
+        });
+    }
+    return results;
+}
+
+qint64 SegmentStore::sampleCount(const QString& username, const QString& device, const QString& channel)
+{
+    Series* source = series(username, device, channel, false);
+    if (!source) {
+        return 0;
+    }
+
+    QMutexLocker locker(&source->mutex);
+    qint64 total = 0;
+    for (const auto& segment : source->segments) {
+        total += qint64(segment->count);
+    }
+    return total;
+}
+
+QStringList SegmentStore::devices(const QString& username) const
+{
+    QStringList result;
+    const QStringList dirs = QDir(m_root + "/" + encodeName(username)).entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QString& name : dirs) {
+        result.append(QUrl::fromPercentEncoding(name.toLatin1()));
+    }
+    return result;
+}
+
+QStringList SegmentStore::channels(const QString& username, const QString& device) const
+{
+    QStringList result;
+    const QString dir = m_root + "/" + encodeName(username) + "/" + encodeName(device);
+    const QStringList dirs = QDir(dir).entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QString& name : dirs) {
+        result.append(QUrl::fromPercentEncoding(name.toLatin1()));
+    }
+    return result;
+}
+
+quint64 SegmentStore::rejectedSamples() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_rejected;
+}
+
+void SegmentStore::close()
+{
+    QMutexLocker locker(&m_mutex);
+    for (Series* series : m_series) {
+        {
+            QMutexLocker seriesLocker(&series->mutex);
+            for (const auto& segment : series->segments) {
+                unmap(series, segment.get());
+            }
+        }
+        delete series;
+    }
+    m_series.clear();
+}
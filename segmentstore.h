@@ -0,0 +1,135 @@
+#ifndef SEGMENTSTORE_H
+#define SEGMENTSTORE_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "sample.h"
+
+// 段文件中的一条记录：时间（epoch 秒）和数值；同一个段内按时间非递减排列
+struct SegmentRecord
+{
+    double timestamp;
+    double value;
+};
+
+// 实时数据的追加式时间序列存储：每个用户/设备/通道一个目录，数据写入定长的二进制段文件，
+// 段写满后封存、开始下一个段。正在写入的段整体内存映射，写入直接落在映射内存上；
+// 封存的段截掉未用的尾部，各段的条数和首末时间记在目录下的 segments.idx 中，打开通道时只读这个索引，
+// 读取时按需映射涉及的段（每个通道至多 MaxMappedSegments 个，最久未用的先解除映射），映射后即关闭文件。
+// 用户和手动录入的数据仍然保存在 SQLite 中（DatabaseManager）。多个线程会同时访问，内部加锁
+class SegmentStore
+{
+public:
+    static SegmentStore& instance();
+
+    QString rootPath() const { return m_root; }
+
+    // 追加一批采样点（timestamp 为 epoch 秒）；device 为稳定的设备标识（蓝牙地址或传输层描述串，见 DeviceSession::deviceKey）。
+    // 返回没有存下的条数（时间为 NaN，或段文件写入失败）；比通道中已有最后时间更早的采样点不丢弃，另起一个段存放
+    int append(const QString& username, const QString& device, const QString& channel, const QVector<Sample>& samples);
+
+    // 读取 [fromMs, toMs] 内的采样点，按时间排序，timestamp 为 epoch 秒
+    QVector<Sample> getSamples(const QString& username, const QString& device, const QString& channel,
+                               qint64 fromMs = std::numeric_limits<qint64>::min(),
+                               qint64 toMs = std::numeric_limits<qint64>::max());
+    // 同上，直接写成曲线用的横纵坐标数组，适合一次载入百万级采样点
+    bool getSeries(const QString& username, const QString& device, const QString& channel, qint64 fromMs, qint64 toMs,
+                   QVector<double>& keys, QVector<double>& values);
+    // 零拷贝遍历：每个段内落在范围中的一段连续记录交给 callback 一次，callback 返回 false 时停止。
+    // 段按首个时间的顺序访问，每块内部有序；只有时钟回拨产生的段会与其他段在时间上重叠。
+    // callback 执行期间持有该通道的锁，不要在其中访问同一通道
+    using RecordCallback = std::function<bool(const SegmentRecord* records, int count)>;
+    bool forEachRange(const QString& username, const QString& device, const QString& channel, qint64 fromMs, qint64 toMs,
+                      const RecordCallback& callback);
+
+    qint64 sampleCount(const QString& username, const QString& device, const QString& channel);
+    QStringList devices(const QString& username) const; // 该用户已有数据的设备标识
+    QStringList channels(const QString& username, const QString& device) const; // 该设备已有数据的通道
+    quint64 rejectedSamples() const; // 没有存下的采样点总数
+    void close(); // 解除所有映射，下次访问时重新打开；只在没有其他线程访问时调用
+
+    static const int RecordsPerSegment = 65536; // 每段 1 MB 数据
+    static const int MaxMappedSegments = 8;     // 每个通道同时映射的已封存段数上限
+
+private:
+    // 段文件头，64 字节；count 在记录写完之后才更新，中途退出时只丢失未计入的记录
+    struct SegmentHeader
+    {
+        char magic[8];
+        quint32 version;
+        quint32 capacity;
+        quint64 count;
+        double firstTimestamp;
+        double lastTimestamp;
+        char reserved[24];
+    };
+
+    struct Segment
+    {
+        int sequence = 0;
+        quint64 count = 0;
+        double firstTimestamp = 0;
+        double lastTimestamp = 0;
+        bool sealed = false;
+
+        QFile file; // 只用来持有映射，映射建立后文件即关闭
+        uchar* map = nullptr;
+        quint64 lastUsed = 0;
+
+        SegmentHeader* header() const { return reinterpret_cast<SegmentHeader*>(map); }
+        SegmentRecord* records() const { return reinterpret_cast<SegmentRecord*>(map + sizeof(SegmentHeader)); }
+    };
+
+    struct Series
+    {
+        QString dir;
+        std::vector<std::unique_ptr<Segment>> segments; // 按序号排列
+        Segment* active = nullptr; // 正在写入的段，始终映射
+        int nextSequence = 0;
+        int mappedSealed = 0;
+        quint64 useClock = 0;
+        QMutex mutex;
+    };
+
+    SegmentStore();
+    ~SegmentStore();
+
+    QString seriesDir(const QString& username, const QString& device, const QString& channel) const;
+    Series* series(const QString& username, const QString& device, const QString& channel, bool create);
+    void loadSeries(Series* series);
+    bool readHeader(const QString& path, SegmentHeader* header) const;
+    bool saveIndex(const Series* series) const;
+    QString segmentPath(const Series* series, int sequence) const;
+
+    Segment* writableSegment(Series* series);
+    bool mapActive(Series* series, Segment* segment, bool create);
+    void seal(Series* series);
+    const SegmentRecord* mapForRead(Series* series, Segment* segment); // 按需映射，超出上限时解除最久未用的映射
+    void unmap(Series* series, Segment* segment);
+
+    // 以下须持有该通道的锁
+    QVector<Segment*> overlapping(Series* series, double from, double to) const; // 与范围相交的非空段，按首个时间排序
+    qint64 countUpperBound(Series* series, double from, double to) const;
+    bool visitRange(Series* series, double from, double to, const RecordCallback& callback);
+
+    static QString encodeName(const QString& name);
+
+    QString m_root;
+    QHash<QString, Series*> m_series; // 通道目录 -> 通道
+    mutable QMutex m_mutex;
+    quint64 m_rejected = 0;
+
+    // 禁止复制
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator=(const SegmentStore&) = delete;
+};
+
+#endif // SEGMENTSTORE_H
@@ -0,0 +1,115 @@
+#include "servicecache.h"
+#include "appsettings.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+
+ServiceCache::ServiceCache()
+{
+    m_path = appDataDir() + "/servicecache.json";
+    load();
+}
+
+ServiceCache& ServiceCache::instance()
+{
+    static ServiceCache instance;
+    return instance;
+}
+
+void ServiceCache::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonArray array = QJsonDocument::fromJson(file.readAll()).array();
+    for (const QJsonValue &value : array) {
+        QJsonObject object = value.toObject();
+        CachedService service;
+        service.address = QBluetoothAddress(object.value("address").toString());
+        service.name = object.value("name").toString();
+        service.uuid = QBluetoothUuid(object.value("uuid").toString());
+        service.channel = quint16(object.value("channel").toInt());
+        service.lastConnectMs = qint64(object.value("lastConnectMs").toDouble(-1));
+        service.lastConnectedAt = qint64(object.value("lastConnectedAt").toDouble());
+        if (!service.address.isNull()) {
+            m_entries.insert(service.address.toString(), service);
+        }
+    }
+    qDebug() << "已加载" << m_entries.size() << "条蓝牙服务缓存";
+}
+
+void ServiceCache::save() const
+{
+    QJsonArray array;
+    for (const CachedService &service : m_entries) {
+        QJsonObject object;
+        object.insert("address", service.address.toString());
+        object.insert("name", service.name);
+        object.insert("uuid", service.uuid.toString());
+        object.insert("channel", service.channel);
+        object.insert("lastConnectMs", double(service.lastConnectMs));
+        object.insert("lastConnectedAt", double(service.lastConnectedAt));
+        array.append(object);
+    }
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "无法写入蓝牙服务缓存:" << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(array).toJson(QJsonDocument::Compact));
+    file.commit();
+}
+
+bool ServiceCache::lookup(const QBluetoothAddress &address, CachedService *service) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(address.toString());
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+    *service = it.value();
+    return true;
+}
+
+void ServiceCache::store(const CachedService &service)
+{
+    QMutexLocker locker(&m_mutex);
+    CachedService &entry = m_entries[service.address.toString()];
+    // 保留已有的连接统计
+    qint64 lastConnectMs = entry.address.isNull() ? -1 : entry.lastConnectMs;
+    qint64 lastConnectedAt = entry.lastConnectedAt;
+    entry = service;
+    entry.lastConnectMs = lastConnectMs;
+    entry.lastConnectedAt = lastConnectedAt;
+    save();
+}
+
+void ServiceCache::recordConnect(const QBluetoothAddress &address, qint64 latencyMs)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(address.toString());
+    if (it == m_entries.end()) {
+        return;
+    }
+    it->lastConnectMs = latencyMs;
+    it->lastConnectedAt = QDateTime::currentMSecsSinceEpoch();
+    save();
+}
+
+QList<CachedService> ServiceCache::entries() const
+{
+    QMutexLocker locker(&m_mutex);
+    QList<CachedService> list = m_entries.values();
+    std::sort(list.begin(), list.end(), [](const CachedService &a, const CachedService &b) {
+        return a.lastConnectedAt > b.lastConnectedAt;
+    });
+    return list;
+}
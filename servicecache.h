@@ -0,0 +1,47 @@
+#ifndef SERVICECACHE_H
+#define SERVICECACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QBluetoothAddress>
+#include <QBluetoothUuid>
+
+// 缓存的一台设备的 RFCOMM 服务
+struct CachedService
+{
+    QBluetoothAddress address;
+    QString name;
+    QBluetoothUuid uuid;
+    quint16 channel = 0;         // RFCOMM 通道号，0 表示未知
+    qint64 lastConnectMs = -1;   // 最近一次连接耗时
+    qint64 lastConnectedAt = 0;  // 最近一次连接成功的时间（epoch 毫秒）
+};
+
+// 设备地址 -> RFCOMM 服务/通道的持久缓存，保存在数据库文件旁的 servicecache.json 中
+// 重连已知设备时跳过设备搜索和 SDP；多个采集线程会同时访问，内部加锁
+class ServiceCache
+{
+public:
+    static ServiceCache& instance();
+
+    bool lookup(const QBluetoothAddress &address, CachedService *service) const;
+    void store(const CachedService &service); // 记录 SDP 结果
+    void recordConnect(const QBluetoothAddress &address, qint64 latencyMs); // 记录连接耗时
+    QList<CachedService> entries() const; // 按最近连接时间从新到旧排列
+
+private:
+    ServiceCache();
+    void load();
+    void save() const;
+
+    QString m_path;
+    QHash<QString, CachedService> m_entries;
+    mutable QMutex m_mutex;
+
+    // 禁止复制
+    ServiceCache(const ServiceCache&) = delete;
+    ServiceCache& operator=(const ServiceCache&) = delete;
+};
+
+#endif // SERVICECACHE_H
@@ -0,0 +1,85 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// 单生产者/单消费者无锁环形缓冲区：采集线程写入，GUI 线程每帧批量取出
+// 容量向上取整到 2 的幂；写满时丢弃新数据并计入溢出计数，不阻塞生产者
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_buffer.resize(size);
+        m_mask = size - 1;
+    }
+
+    // 生产者线程调用：写入 count 个元素，返回实际写入的个数
+    size_t push(const T *items, size_t count)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        const size_t used = head - tail;
+        const size_t free = m_buffer.size() - used;
+        const size_t n = count < free ? count : free;
+
+        for (size_t i = 0; i < n; ++i) {
+            m_buffer[(head + i) & m_mask] = items[i];
+        }
+        m_head.store(head + n, std::memory_order_release);
+
+        if (n < count) {
+            m_overflow.fetch_add(count - n, std::memory_order_relaxed);
+        }
+        const size_t occupancy = used + n;
+        if (occupancy > m_highWater.load(std::memory_order_relaxed)) {
+            m_highWater.store(occupancy, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    bool push(const T &item) { return push(&item, 1) == 1; }
+
+    // 消费者线程调用：取出至多 maxCount 个元素追加到 out，返回取出的个数
+    template <typename Container>
+    size_t drain(Container &out, size_t maxCount = size_t(-1))
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        const size_t available = head - tail;
+        const size_t n = available < maxCount ? available : maxCount;
+
+        out.reserve(out.size() + int(n));
+        for (size_t i = 0; i < n; ++i) {
+            out.push_back(m_buffer[(tail + i) & m_mask]);
+        }
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t capacity() const { return m_buffer.size(); }
+    size_t size() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); } // 当前占用
+    size_t highWater() const { return m_highWater.load(std::memory_order_relaxed); } // 占用峰值
+    quint64 overflowCount() const { return m_overflow.load(std::memory_order_relaxed); } // 因写满被丢弃的元素总数
+
+private:
+    std::vector<T> m_buffer;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_head{0}; // 写位置，仅生产者修改
+    alignas(64) std::atomic<size_t> m_tail{0}; // 读位置，仅消费者修改
+    alignas(64) std::atomic<size_t> m_highWater{0};
+    std::atomic<quint64> m_overflow{0};
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+};
+
+#endif // SPSCRING_H
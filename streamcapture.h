@@ -0,0 +1,61 @@
+#ifndef STREAMCAPTURE_H
+#define STREAMCAPTURE_H
+
+#include <QFile>
+#include <QElapsedTimer>
+#include "transport.h"
+
+// 原始字节流抓包文件格式（小端）：
+//   文件头   8 字节魔数 "WLCAP01\0"
+//   每条记录 quint64 自开始抓包起的单调时钟纳秒数 + quint32 长度 + 原始字节
+// 记录的是传输层一次 readAll 的原始数据块，回放时能重现内核的拆包/合包情况
+
+// 抓包写入器：BlueDevice 在解码前把每个数据块写进来
+class CaptureWriter
+{
+public:
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    void write(const char *data, int size);
+
+    qint64 chunksWritten() const { return m_chunks; }
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock;
+    qint64 m_chunks = 0;
+};
+
+// 抓包回放：作为一个传输层后端，把抓包文件按原始节奏送回重组 → 解码 → 绘图 → 存储链路
+// speed 为 1 时按原速，N 时按 N 倍速，0 时以最快速度回放（用于测量整条链路的吞吐量）
+class ReplayTransport : public Transport
+{
+    Q_OBJECT
+public:
+    explicit ReplayTransport(const QString &path, double speed = 1.0, QObject *parent = nullptr);
+
+    void open() override;
+    void close() override;
+    bool isOpen() const override { return m_file.isOpen(); }
+    QByteArray readAll() override;
+    qint64 write(const QByteArray &data) override { return data.size(); } // 回放时丢弃下发的命令
+    bool reportsBytesWritten() const override { return false; }
+    QString description() const override;
+
+private:
+    bool readRecord(); // 预读下一条记录到 m_nextChunk，文件结束返回 false
+    void replayDue();
+
+    QFile m_file;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    double m_speed;
+    QByteArray m_pending;
+    QByteArray m_nextChunk;
+    quint64 m_nextTime = 0;
+    bool m_hasNext = false;
+    qint64 m_bytesReplayed = 0;
+};
+
+#endif // STREAMCAPTURE_H
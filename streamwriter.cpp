@@ -0,0 +1,228 @@
+#include "streamwriter.h"
+#include "databasemanager.h"
+#include "segmentstore.h"
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+StreamWriter::StreamWriter(const QString &username, const QStringList &channelNames, Backend backend,
+                           int batchSize, int flushIntervalMs, QObject *parent)
+    : QObject(parent)
+    , m_username(username)
+    , m_channelNames(channelNames)
+    , m_backend(backend)
+    , m_batchSize(qMax(1, batchSize))
+    , m_flushIntervalMs(qMax(10, flushIntervalMs))
+    , m_maxPending(qMax(100000, m_batchSize * 50))
+{
+    m_context.moveToThread(&m_thread);
+    m_thread.setObjectName("StreamWriter");
+    m_thread.start();
+
+    QMetaObject::invokeMethod(&m_context, [this]() {
+        if (m_backend == Backend::Sqlite) {
+            DatabaseManager::instance().database(); // 提前打开写入线程的连接，第一次刷新不用等
+        }
+        m_timer = new QTimer(&m_context);
+        connect(m_timer, &QTimer::timeout, &m_context, [this]() { flush(); });
+        m_timer->start(m_flushIntervalMs);
+    });
+}
+
+StreamWriter::~StreamWriter()
+{
+    // 在写入线程里写完剩余数据；线程结束时 DatabaseManager 关闭该线程的连接
+    QMetaObject::invokeMethod(&m_context, [this]() {
+        delete m_timer;
+        m_timer = nullptr;
+        flush();
+        m_fullInsert = QSqlQuery();
+        m_tailInsert = QSqlQuery();
+    }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+
+    qDebug() << "实时数据落盘" << rowsWritten() << "行，" << transactions() << "个事务，丢弃" << rowsDropped() << "行";
+}
+
+void StreamWriter::append(const QString &device, const SampleBatch &samples)
+{
+    if (samples.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // 每行只存设备标识的下标；同时连接的设备只有几台，线性查找即可
+    int deviceIndex = m_devices.indexOf(device);
+    if (deviceIndex < 0) {
+        deviceIndex = m_devices.size();
+        m_devices.append(device);
+    }
+    int overflow = m_pending.size() + samples.size() - m_maxPending;
+    if (overflow > 0) {
+        // 写入长时间跟不上时丢弃最旧的积压，避免内存无限增长
+        m_pending.remove(0, qMin(overflow, int(m_pending.size())));
+        m_rowsDropped.fetch_add(quint64(overflow), std::memory_order_relaxed);
+    }
+    for (const Sample &sample : samples) {
+        m_pending.append(Row{sample.timestamp, sample.value, sample.channel, deviceIndex});
+    }
+
+    // 攒够一批立即通知写入线程，不等定时器
+    if (m_pending.size() >= m_batchSize && !m_flushRequested) {
+        m_flushRequested = true;
+        QMetaObject::invokeMethod(&m_context, [this]() { flush(); });
+    }
+}
+
+void StreamWriter::appendGap(const QString &device, double gapStart, int channelCount)
+{
+    // 段文件和 sensor_samples 中都按普通采样点保存，读出后画曲线时 NaN 使曲线在这里断开
+    SampleBatch gap;
+    for (int channel = 0; channel < qMax(1, channelCount); ++channel) {
+        gap.append(Sample{gapStart, qQNaN(), channel});
+    }
+    append(device, gap);
+}
+
+int StreamWriter::pendingRows() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pending.size();
+}
+
+void StreamWriter::flush()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_flushRequested = false;
+        m_writing.swap(m_pending); // 两个数组轮换，容量复用
+        m_writingDevices = m_devices;
+    }
+    if (m_writing.isEmpty()) {
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    // 段文件逐条接受或拒绝，SQLite 整批成功或失败
+    const int dropped = m_backend == Backend::Segments ? writeSegments(m_writing)
+                                                       : (writeRows(m_writing) ? 0 : int(m_writing.size()));
+    const int written = int(m_writing.size()) - dropped;
+    if (written > 0) {
+        m_rowsWritten.fetch_add(quint64(written), std::memory_order_relaxed);
+        m_transactions.fetch_add(1, std::memory_order_relaxed);
+        if (clock.elapsed() > m_flushIntervalMs) {
+            qDebug() << "写入" << written << "行耗时" << clock.elapsed() << "ms，超过刷新间隔";
+        }
+    }
+    if (dropped > 0) {
+        m_rowsDropped.fetch_add(quint64(dropped), std::memory_order_relaxed);
+    }
+    m_writing.resize(0);
+}
+
+QString StreamWriter::channelName(int channel) const
+{
+    return channel < m_channelNames.size() ? m_channelNames.at(channel) : QString("ch%1").arg(channel);
+}
+
+int StreamWriter::writeSegments(const QVector<Row> &rows)
+{
+    // 按设备和通道拆开，每台设备的每个通道是一个独立的序列；批内先按时间排好序，
+    // 批与批之间的时间倒退由 SegmentStore 另起新段处理
+    for (auto it = m_seriesRows.begin(); it != m_seriesRows.end();) {
+        if (it.value().isEmpty()) {
+            it = m_seriesRows.erase(it); // 上一批没有数据的设备（已断开）不再保留
+        } else {
+            it.value().resize(0);
+            ++it;
+        }
+    }
+    for (const Row &row : rows) {
+        m_seriesRows[qMakePair(row.device, row.channel)].append(Sample{row.timestamp, row.value, row.channel});
+    }
+
+    int dropped = 0;
+    for (auto it = m_seriesRows.begin(); it != m_seriesRows.end(); ++it) {
+        SampleBatch &batch = it.value();
+        if (batch.isEmpty()) {
+            continue;
+        }
+        std::stable_sort(batch.begin(), batch.end(), [](const Sample &a, const Sample &b) {
+            return a.timestamp < b.timestamp;
+        });
+        const QString &device = m_writingDevices.at(it.key().first);
+        const QString channel = channelName(it.key().second);
+        const int rejected = SegmentStore::instance().append(m_username, device, channel, batch);
+        if (rejected > 0) {
+            qDebug() << "段文件没有存下" << rejected << "个采样点:" << device << channel;
+            dropped += rejected;
+        }
+    }
+    return dropped;
+}
+
+QSqlQuery &StreamWriter::insertStatement(int rowCount)
+{
+    // 整块语句始终复用；最后不足一块的尾部按行数缓存，行数变化时才重新预编译
+    const bool full = rowCount == RowsPerStatement;
+    QSqlQuery &query = full ? m_fullInsert : m_tailInsert;
+    int &preparedRows = full ? m_fullRows : m_tailRows;
+    if (preparedRows != rowCount) {
+        QString sql = "INSERT INTO sensor_samples (username, device, channel, timestamp, value) VALUES ";
+        for (int i = 0; i < rowCount; ++i) {
+            sql += i == 0 ? "(?, ?, ?, ?, ?)" : ", (?, ?, ?, ?, ?)";
+        }
+        query = QSqlQuery(DatabaseManager::instance().database());
+        if (query.prepare(sql)) {
+            preparedRows = rowCount;
+        } else {
+            qDebug() << "预编译批量插入失败:" << query.lastError().text();
+        }
+    }
+    return query;
+}
+
+bool StreamWriter::writeRows(const QVector<Row> &rows)
+{
+    QSqlDatabase db = DatabaseManager::instance().database();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    // 一批数据一个事务；每条语句插入至多 RowsPerStatement 行
+    if (!db.transaction()) {
+        qDebug() << "开启事务失败:" << db.lastError().text();
+        return false;
+    }
+
+    for (int start = 0; start < rows.size(); start += RowsPerStatement) {
+        const int count = qMin(int(RowsPerStatement), int(rows.size()) - start);
+        QSqlQuery &query = insertStatement(count);
+        for (int i = 0; i < count; ++i) {
+            const Row &row = rows.at(start + i);
+            const int base = i * 5;
+            query.bindValue(base, m_username);
+            query.bindValue(base + 1, m_writingDevices.at(row.device));
+            query.bindValue(base + 2, channelName(row.channel));
+            query.bindValue(base + 3, qRound64(row.timestamp * 1000.0));
+            // 断线标记的 NaN 存为 NULL
+            query.bindValue(base + 4, std::isnan(row.value) ? QVariant(QMetaType::fromType<double>()) : QVariant(row.value));
+        }
+        if (!query.exec()) {
+            qDebug() << "批量写入采样点失败:" << query.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!db.commit()) {
+        qDebug() << "提交事务失败:" << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef STREAMWRITER_H
+#define STREAMWRITER_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <atomic>
+#include "sample.h"
+
+// 实时数据落盘：GUI 线程把采样点交给 append，后台写入线程每攒够 batchSize 行或每隔 flushIntervalMs 写入一次。
+// 默认按设备和通道写入 SegmentStore 的段文件；Backend::Sqlite 时用一个事务和绑定参数的多行 INSERT 写入 sensor_samples 表，
+// 写入线程通过 DatabaseManager 取得自己的连接（WAL 模式），提交时 GUI 线程仍可读取历史数据
+class StreamWriter : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Backend { Segments, Sqlite };
+
+    // channelNames[i] 为通道 i 在数据库中的名称，超出范围的通道记为 "ch<i>"
+    StreamWriter(const QString &username, const QStringList &channelNames, Backend backend = Backend::Segments,
+                 int batchSize = 2000, int flushIntervalMs = 500, QObject *parent = nullptr);
+    ~StreamWriter(); // 写完剩余数据后停止写入线程
+
+    // 可在任意线程调用，只做一次加锁拷贝；device 为稳定的设备标识（DeviceSession::deviceKey），区分同时连接的设备
+    void append(const QString &device, const SampleBatch &samples);
+    void appendGap(const QString &device, double gapStart, int channelCount); // 断线标记：在断开时刻给每个通道写入一个数值为 NaN 的采样点
+
+    quint64 rowsWritten() const { return m_rowsWritten.load(std::memory_order_relaxed); }
+    quint64 transactions() const { return m_transactions.load(std::memory_order_relaxed); }
+    quint64 rowsDropped() const { return m_rowsDropped.load(std::memory_order_relaxed); } // 积压超限时丢弃的行，以及写入失败、没有存下的行
+    int pendingRows() const;
+
+private:
+    struct Row
+    {
+        double timestamp; // epoch 秒
+        double value;
+        int channel;
+        int device; // m_devices 中的下标
+    };
+
+    // 以下在写入线程执行
+    void flush();
+    bool writeRows(const QVector<Row> &rows);
+    int writeSegments(const QVector<Row> &rows); // 返回没有存下的行数
+    QString channelName(int channel) const;
+    QSqlQuery &insertStatement(int rowCount); // 按行数复用预编译的多行 INSERT
+
+    static const int RowsPerStatement = 199; // 每行 5 个参数，不超过 SQLite 默认的 999 个参数上限
+
+    QThread m_thread;
+    QObject m_context; // 在写入线程中的上下文对象，定时器和刷新都在它上面执行
+    QTimer *m_timer = nullptr;
+    QString m_username;
+    QStringList m_channelNames;
+    Backend m_backend;
+    int m_batchSize;
+    int m_flushIntervalMs;
+    int m_maxPending;
+
+    mutable QMutex m_mutex;
+    QVector<Row> m_pending; // GUI 线程追加，写入线程整体取走
+    QStringList m_devices; // 出现过的设备标识，只增不减
+    bool m_flushRequested = false;
+
+    // 写入线程独占
+    QVector<Row> m_writing;
+    QStringList m_writingDevices; // 取走 m_writing 时的 m_devices
+    QHash<QPair<int, int>, SampleBatch> m_seriesRows; // (设备, 通道) -> 拆分后的一批数据，容量复用
+    QSqlQuery m_fullInsert;
+    QSqlQuery m_tailInsert;
+    int m_fullRows = 0; // 已预编译语句对应的行数
+    int m_tailRows = 0;
+
+    std::atomic<quint64> m_rowsWritten{0};
+    std::atomic<quint64> m_transactions{0};
+    std::atomic<quint64> m_rowsDropped{0};
+};
+
+#endif // STREAMWRITER_H
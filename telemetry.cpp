@@ -0,0 +1,55 @@
+#include "telemetry.h"
+#include "devicesession.h"
+
+IngestTelemetry::IngestTelemetry(DeviceSessionManager *manager, int intervalMs, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+{
+    m_last = m_manager->stats();
+    m_clock.start();
+    connect(&m_timer, &QTimer::timeout, this, &IngestTelemetry::sample);
+    m_timer.start(qMax(100, intervalMs));
+}
+
+void IngestTelemetry::recordPlotLatency(double ms)
+{
+    m_latency.record(ms);
+}
+
+void IngestTelemetry::sample()
+{
+    IngestStats now = m_manager->stats();
+    double seconds = qMax<qint64>(1, m_clock.restart()) / 1000.0;
+
+    // 会话被移除时累计值可能变小，此时本周期的速率按 0 计
+    m_snapshot.framesPerSecond = now.frames >= m_last.frames ? (now.frames - m_last.frames) / seconds : 0.0;
+    m_snapshot.bytesPerSecond = now.bytes >= m_last.bytes ? (now.bytes - m_last.bytes) / seconds : 0.0;
+    m_snapshot.totals = now;
+    m_last = now;
+
+    m_snapshot.latencySamples = m_latency.count();
+    m_snapshot.latencyP50Ms = m_latency.percentile(0.50);
+    m_snapshot.latencyP95Ms = m_latency.percentile(0.95);
+    m_snapshot.latencyP99Ms = m_latency.percentile(0.99);
+    m_snapshot.latencyMaxMs = m_latency.max();
+    m_latency.reset();
+
+    emit updated(m_snapshot);
+}
+
+QString IngestTelemetry::summary() const
+{
+    const TelemetrySnapshot &s = m_snapshot;
+    return QString("%1 帧/s  %2 KB/s  拒收帧 %3  重同步 %4 B  重组缓冲峰值 %5 B  队列 %6/峰值 %7  溢出 %8  延迟 p50/p95/p99 %9/%10/%11 ms")
+        .arg(s.framesPerSecond, 0, 'f', 0)
+        .arg(s.bytesPerSecond / 1024.0, 0, 'f', 1)
+        .arg(s.totals.rejectedFrames)
+        .arg(s.totals.resyncBytes)
+        .arg(s.totals.bufferHighWater)
+        .arg(s.totals.ringOccupancy)
+        .arg(s.totals.ringHighWater)
+        .arg(s.totals.ringOverflow)
+        .arg(s.latencyP50Ms, 0, 'f', 1)
+        .arg(s.latencyP95Ms, 0, 'f', 1)
+        .arg(s.latencyP99Ms, 0, 'f', 1);
+}
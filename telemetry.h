@@ -0,0 +1,50 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "ingeststats.h"
+
+class DeviceSessionManager;
+
+// 一个统计周期的遥测结果
+struct TelemetrySnapshot
+{
+    IngestStats totals;          // 所有会话的累计计数
+    double framesPerSecond = 0;  // 本周期的帧率
+    double bytesPerSecond = 0;   // 本周期的接收字节率
+    quint64 latencySamples = 0;  // 本周期记录的接收到绘图延迟个数
+    double latencyP50Ms = 0;
+    double latencyP95Ms = 0;
+    double latencyP99Ms = 0;
+    double latencyMaxMs = 0;
+};
+
+// 采集链路遥测：每个周期汇总所有会话的计数，算出帧率、字节率，以及接收到绘图的延迟分位数
+// 在 GUI 线程使用；延迟由绘图代码在数据画出后调用 recordPlotLatency 记录
+class IngestTelemetry : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IngestTelemetry(DeviceSessionManager *manager, int intervalMs = 1000, QObject *parent = nullptr);
+
+    void recordPlotLatency(double ms);
+    TelemetrySnapshot snapshot() const { return m_snapshot; } // 最近一个周期的结果
+    QString summary() const; // 状态栏显示的一行摘要
+
+signals:
+    void updated(const TelemetrySnapshot &snapshot);
+
+private:
+    void sample();
+
+    DeviceSessionManager *m_manager;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    IngestStats m_last;
+    LatencyHistogram m_latency; // 当前周期的延迟
+    TelemetrySnapshot m_snapshot;
+};
+
+#endif // TELEMETRY_H
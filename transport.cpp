@@ -0,0 +1,428 @@
+#include "transport.h"
+#include "streamcapture.h"
+#include <QDebug>
+#include <QUrlQuery>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <cerrno>
+#endif
+
+Transport *createTransport(const QString &spec, QObject *parent)
+{
+    const QString scheme = spec.section("://", 0, 0).toLower();
+    QString target = spec.section("://", 1);
+    QUrlQuery query;
+    int queryPos = target.indexOf('?');
+    if (queryPos >= 0) {
+        query.setQuery(target.mid(queryPos + 1));
+        target = target.left(queryPos);
+    }
+
+    if (scheme == "rfcomm") {
+        quint16 channel = query.hasQueryItem("channel") ? query.queryItemValue("channel").toUShort() : 0;
+        return new RfcommTransport(QBluetoothAddress(target),
+                                   QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::SerialPort), channel, parent);
+    } else if (scheme == "tcp") {
+        int colon = target.lastIndexOf(':');
+        if (colon < 0) {
+            return nullptr;
+        }
+        return new TcpTransport(target.left(colon), target.mid(colon + 1).toUShort(), parent);
+    } else if (scheme == "local") {
+        return new LocalSocketTransport(target, parent);
+    } else if (scheme == "pty") {
+        return new PtyTransport(target, parent);
+    } else if (scheme == "file") {
+        int chunk = query.hasQueryItem("chunk") ? query.queryItemValue("chunk").toInt() : 64;
+        int interval = query.hasQueryItem("interval") ? query.queryItemValue("interval").toInt() : 1;
+        return new FileTransport(target, chunk, interval, parent);
+    } else if (scheme == "sim") {
+        int rate = query.hasQueryItem("rate") ? query.queryItemValue("rate").toInt() : 500;
+        int channels = query.hasQueryItem("channels") ? query.queryItemValue("channels").toInt() : 1;
+        return new SimulatorTransport(rate, channels, parent);
+    } else if (scheme == "replay") {
+        double speed = query.hasQueryItem("speed") ? query.queryItemValue("speed").toDouble() : 1.0;
+        return new ReplayTransport(target, speed, parent);
+    }
+
+    qDebug() << "无法识别的传输层:" << spec;
+    return nullptr;
+}
+
+qint64 Transport::readInto(QByteArray &buffer)
+{
+    const QByteArray data = readAll();
+    buffer.append(data);
+    return data.size();
+}
+
+qint64 IoDeviceTransport::readInto(QByteArray &buffer)
+{
+    // 直接读进调用方的缓冲区，缓冲区容量被反复复用
+    const qint64 available = m_device ? m_device->bytesAvailable() : 0;
+    if (available <= 0) {
+        return 0;
+    }
+    const int oldSize = buffer.size();
+    buffer.resize(oldSize + int(available));
+    const qint64 n = m_device->read(buffer.data() + oldSize, available);
+    buffer.resize(oldSize + int(qMax<qint64>(0, n)));
+    return n;
+}
+
+void IoDeviceTransport::setDevice(QIODevice *device)
+{
+    m_device = device;
+    connect(device, &QIODevice::readyRead, this, &Transport::readyRead);
+    connect(device, &QIODevice::bytesWritten, this, &Transport::bytesWritten);
+}
+
+// ---------------- RFCOMM ----------------
+
+RfcommTransport::RfcommTransport(const QBluetoothAddress &address, const QBluetoothUuid &uuid,
+                                 quint16 channel, QObject *parent)
+    : IoDeviceTransport(parent)
+    , m_socket(new QBluetoothSocket(QBluetoothServiceInfo::RfcommProtocol, this))
+    , m_address(address)
+    , m_uuid(uuid)
+    , m_channel(channel)
+{
+    setDevice(m_socket);
+    connect(m_socket, &QBluetoothSocket::connected, this, &Transport::connected);
+    connect(m_socket, &QBluetoothSocket::disconnected, this, &Transport::disconnected);
+    connect(m_socket, &QBluetoothSocket::errorOccurred, this, [this](QBluetoothSocket::SocketError error) {
+        emit socketErrorOccurred(error);
+        emit errorOccurred(m_socket->errorString());
+    });
+}
+
+void RfcommTransport::open()
+{
+#ifndef Q_OS_ANDROID
+    if (m_channel > 0) {
+        m_socket->connectToService(m_address, m_channel);
+        return;
+    }
+#endif
+    m_socket->connectToService(m_address, m_uuid);
+}
+
+void RfcommTransport::close()
+{
+    if (m_socket->isOpen()) {
+        m_socket->close();
+    }
+}
+
+bool RfcommTransport::isOpen() const
+{
+    return m_socket->state() == QBluetoothSocket::SocketState::ConnectedState;
+}
+
+bool RfcommTransport::isConnecting() const
+{
+    return m_socket->state() == QBluetoothSocket::SocketState::ConnectingState
+        || m_socket->state() == QBluetoothSocket::SocketState::ServiceLookupState;
+}
+
+QString RfcommTransport::description() const
+{
+    return m_channel > 0 ? QString("rfcomm://%1?channel=%2").arg(m_address.toString()).arg(m_channel)
+                         : "rfcomm://" + m_address.toString();
+}
+
+// ---------------- TCP ----------------
+
+TcpTransport::TcpTransport(const QString &host, quint16 port, QObject *parent)
+    : IoDeviceTransport(parent)
+    , m_socket(new QTcpSocket(this))
+    , m_host(host)
+    , m_port(port)
+{
+    setDevice(m_socket);
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    connect(m_socket, &QTcpSocket::connected, this, &Transport::connected);
+    connect(m_socket, &QTcpSocket::disconnected, this, &Transport::disconnected);
+    connect(m_socket, &QTcpSocket::errorOccurred, this, [this]() {
+        emit errorOccurred(m_socket->errorString());
+    });
+}
+
+void TcpTransport::open()
+{
+    m_socket->connectToHost(m_host, m_port);
+}
+
+void TcpTransport::close()
+{
+    m_socket->disconnectFromHost();
+}
+
+bool TcpTransport::isConnecting() const
+{
+    return m_socket->state() == QAbstractSocket::HostLookupState
+        || m_socket->state() == QAbstractSocket::ConnectingState;
+}
+
+QString TcpTransport::description() const
+{
+    return QString("tcp://%1:%2").arg(m_host).arg(m_port);
+}
+
+// ---------------- QLocalSocket ----------------
+
+LocalSocketTransport::LocalSocketTransport(const QString &name, QObject *parent)
+    : IoDeviceTransport(parent)
+    , m_socket(new QLocalSocket(this))
+    , m_name(name)
+{
+    setDevice(m_socket);
+    connect(m_socket, &QLocalSocket::connected, this, &Transport::connected);
+    connect(m_socket, &QLocalSocket::disconnected, this, &Transport::disconnected);
+    connect(m_socket, &QLocalSocket::errorOccurred, this, [this]() {
+        emit errorOccurred(m_socket->errorString());
+    });
+}
+
+void LocalSocketTransport::open()
+{
+    m_socket->connectToServer(m_name);
+}
+
+void LocalSocketTransport::close()
+{
+    m_socket->disconnectFromServer();
+}
+
+// ---------------- 伪终端 ----------------
+
+PtyTransport::PtyTransport(const QString &path, QObject *parent)
+    : Transport(parent)
+    , m_path(path)
+{
+}
+
+PtyTransport::~PtyTransport()
+{
+    close();
+}
+
+void PtyTransport::open()
+{
+#ifdef Q_OS_UNIX
+    m_fd = ::open(QFile::encodeName(m_path).constData(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (m_fd < 0) {
+        emit errorOccurred(QString("无法打开 %1: %2").arg(m_path, QString::fromLocal8Bit(strerror(errno))));
+        return;
+    }
+
+    // 原始模式：不做行缓冲和字符转换
+    termios tio;
+    if (tcgetattr(m_fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(m_fd, TCSANOW, &tio);
+    }
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &Transport::readyRead);
+    QTimer::singleShot(0, this, &Transport::connected);
+#else
+    emit errorOccurred("当前平台不支持伪终端传输");
+#endif
+}
+
+void PtyTransport::close()
+{
+#ifdef Q_OS_UNIX
+    if (m_fd < 0) {
+        return;
+    }
+    delete m_notifier;
+    m_notifier = nullptr;
+    ::close(m_fd);
+    m_fd = -1;
+    emit disconnected();
+#endif
+}
+
+QByteArray PtyTransport::readAll()
+{
+    QByteArray data;
+    readInto(data);
+    return data;
+}
+
+qint64 PtyTransport::readInto(QByteArray &buffer)
+{
+    qint64 total = 0;
+#ifdef Q_OS_UNIX
+    const int chunk = 4096;
+    while (m_fd >= 0) {
+        const int oldSize = buffer.size();
+        buffer.resize(oldSize + chunk);
+        ssize_t n = ::read(m_fd, buffer.data() + oldSize, chunk);
+        buffer.resize(oldSize + int(qMax<ssize_t>(0, n)));
+        if (n > 0) {
+            total += n;
+        } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            // 对端关闭（伪终端主端退出时 read 返回 EIO）
+            QTimer::singleShot(0, this, &PtyTransport::close);
+            break;
+        } else if (errno == EAGAIN) {
+            break;
+        }
+    }
+#else
+    Q_UNUSED(buffer);
+#endif
+    return total;
+}
+
+qint64 PtyTransport::write(const QByteArray &data)
+{
+#ifdef Q_OS_UNIX
+    if (m_fd < 0) {
+        return -1;
+    }
+    ssize_t n = ::write(m_fd, data.constData(), size_t(data.size()));
+    if (n > 0) {
+        QTimer::singleShot(0, this, [this, n]() { emit bytesWritten(n); });
+    }
+    return n;
+#else
+    Q_UNUSED(data);
+    return -1;
+#endif
+}
+
+// ---------------- 文件 ----------------
+
+FileTransport::FileTransport(const QString &path, int chunkSize, int intervalMs, QObject *parent)
+    : Transport(parent)
+    , m_file(path)
+    , m_chunkSize(chunkSize)
+{
+    m_timer.setInterval(intervalMs);
+    connect(&m_timer, &QTimer::timeout, this, [this]() {
+        QByteArray chunk = m_file.read(m_chunkSize);
+        if (chunk.isEmpty()) {
+            close();
+            return;
+        }
+        m_pending.append(chunk);
+        emit readyRead();
+    });
+}
+
+void FileTransport::open()
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        emit errorOccurred(m_file.errorString());
+        return;
+    }
+    m_timer.start();
+    QTimer::singleShot(0, this, &Transport::connected);
+}
+
+void FileTransport::close()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+    m_timer.stop();
+    m_file.close();
+    emit disconnected();
+}
+
+QByteArray FileTransport::readAll()
+{
+    QByteArray data;
+    data.swap(m_pending);
+    return data;
+}
+
+// ---------------- 模拟器 ----------------
+
+SimulatorTransport::SimulatorTransport(int frameRate, int channels, QObject *parent)
+    : Transport(parent)
+    , m_frameRate(qMax(1, frameRate))
+    , m_channels(qBound(1, channels, 32))
+{
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(5);
+    connect(&m_timer, &QTimer::timeout, this, &SimulatorTransport::generate);
+}
+
+void SimulatorTransport::open()
+{
+    m_framesSent = 0;
+    m_clock.start();
+    m_timer.start();
+    QTimer::singleShot(0, this, &Transport::connected);
+}
+
+void SimulatorTransport::close()
+{
+    if (!m_timer.isActive()) {
+        return;
+    }
+    m_timer.stop();
+    m_pending.clear();
+    emit disconnected();
+}
+
+void SimulatorTransport::generate()
+{
+    static const char tail[4] = {0x00, 0x00, char(0x80), 0x7f};
+
+    // 按真实经过的时间补齐应发送的帧数，定时器抖动不影响平均帧率
+    qint64 target = m_clock.elapsed() * m_frameRate / 1000;
+    for (; m_framesSent < target; ++m_framesSent) {
+        // 通道 0 模拟体重，1 模拟阻抗，2 模拟体脂率，其余为不同相位的正弦波
+        double t = double(m_framesSent) / m_frameRate;
+        for (int channel = 0; channel < m_channels; ++channel) {
+            double wave = qSin(2.0 * M_PI * 0.2 * t + channel);
+            float value;
+            switch (channel) {
+            case 0: value = float(60.0 + 2.0 * wave); break;
+            case 1: value = float(500.0 + 20.0 * wave); break;
+            case 2: value = float(0.22 + 0.01 * wave); break;
+            default: value = float(wave); break;
+            }
+            m_pending.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+        m_pending.append(tail, sizeof(tail));
+    }
+    if (!m_pending.isEmpty()) {
+        emit readyRead();
+    }
+}
+
+QByteArray SimulatorTransport::readAll()
+{
+    if (m_pending.isEmpty()) {
+        return QByteArray();
+    }
+
+    // 随机截断，模拟内核把帧拆到两次读取中的情况；剩余部分再次触发 readyRead
+    int n = 1 + QRandomGenerator::global()->bounded(m_pending.size());
+    QByteArray data = m_pending.left(n);
+    m_pending.remove(0, n);
+    if (!m_pending.isEmpty()) {
+        QTimer::singleShot(0, this, &Transport::readyRead);
+    }
+    return data;
+}
+
+qint64 SimulatorTransport::write(const QByteArray &data)
+{
+    qint64 n = data.size();
+    QTimer::singleShot(0, this, [this, n]() { emit bytesWritten(n); });
+    return n;
+}
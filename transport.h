@@ -0,0 +1,210 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include <QSocketNotifier>
+#include <QBluetoothSocket>
+#include <QBluetoothAddress>
+#include <QBluetoothUuid>
+
+// 字节流传输层：BlueDevice 只通过这个接口收发数据，
+// RFCOMM、伪终端、TCP/本地套接字、文件和模拟器都可以作为后端，重组、解码、绘图和存储逻辑保持不变
+class Transport : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Transport(QObject *parent = nullptr) : QObject(parent) {}
+
+    virtual void open() = 0; // 异步打开，成功后发 connected()
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0; // 已连接，可以收发
+    virtual bool isConnecting() const { return false; } // 正在建立连接
+    virtual QByteArray readAll() = 0;
+    virtual qint64 readInto(QByteArray &buffer); // 把可读数据直接追加到 buffer 末尾，返回字节数
+    virtual qint64 write(const QByteArray &data) = 0;
+    virtual qint64 bytesToWrite() const { return 0; }
+    virtual bool reportsBytesWritten() const { return true; } // 写出的数据是否会通过 bytesWritten() 确认
+    virtual QString description() const = 0; // 用于日志的描述，例如 "tcp://127.0.0.1:9000"
+
+signals:
+    void connected();
+    void disconnected();
+    void readyRead();
+    void bytesWritten(qint64 bytes);
+    void errorOccurred(const QString &message);
+};
+
+// 根据描述串创建传输层，支持：
+//   rfcomm://AA:BB:CC:DD:EE:FF   经典蓝牙串口服务，可加 ?channel=N 直接连接已知通道
+//   pty:///dev/pts/3             伪终端或串口设备
+//   tcp://127.0.0.1:9000         TCP
+//   local://robot-sim            QLocalSocket
+//   file:///path/to/dump.bin     按固定速率读取文件
+//   sim://?rate=500&channels=3   内置 JustFloat 模拟器，rate 为每秒帧数，channels 为每帧 float 个数
+//   replay:///path/cap.bin?speed=4  回放抓包文件，speed=0 为最快速度
+// 无法识别时返回 nullptr
+Transport *createTransport(const QString &spec, QObject *parent = nullptr);
+
+// 基于 QIODevice 的后端的公共部分
+class IoDeviceTransport : public Transport
+{
+    Q_OBJECT
+public:
+    explicit IoDeviceTransport(QObject *parent = nullptr) : Transport(parent) {}
+
+    QByteArray readAll() override { return m_device ? m_device->readAll() : QByteArray(); }
+    qint64 readInto(QByteArray &buffer) override;
+    qint64 write(const QByteArray &data) override { return m_device ? m_device->write(data) : -1; }
+    qint64 bytesToWrite() const override { return m_device ? m_device->bytesToWrite() : 0; }
+
+protected:
+    void setDevice(QIODevice *device);
+
+private:
+    QPointer<QIODevice> m_device;
+};
+
+// 经典蓝牙 RFCOMM
+class RfcommTransport : public IoDeviceTransport
+{
+    Q_OBJECT
+public:
+    // channel 非 0 时直接连接该 RFCOMM 通道，跳过 SDP（Android 只支持按 UUID 连接）
+    RfcommTransport(const QBluetoothAddress &address,
+                    const QBluetoothUuid &uuid = QBluetoothUuid(QBluetoothUuid::ServiceClassUuid::SerialPort),
+                    quint16 channel = 0, QObject *parent = nullptr);
+
+    void open() override;
+    void close() override;
+    bool isOpen() const override;
+    bool isConnecting() const override;
+    QString description() const override;
+
+    QBluetoothAddress address() const { return m_address; }
+    QBluetoothUuid uuid() const { return m_uuid; }
+    quint16 peerChannel() const { return m_socket->peerPort(); } // 实际连上的 RFCOMM 通道号
+
+signals:
+    void socketErrorOccurred(QBluetoothSocket::SocketError error);
+
+private:
+    QBluetoothSocket *m_socket;
+    QBluetoothAddress m_address;
+    QBluetoothUuid m_uuid;
+    quint16 m_channel;
+};
+
+// TCP
+class TcpTransport : public IoDeviceTransport
+{
+    Q_OBJECT
+public:
+    TcpTransport(const QString &host, quint16 port, QObject *parent = nullptr);
+
+    void open() override;
+    void close() override;
+    bool isOpen() const override { return m_socket->state() == QAbstractSocket::ConnectedState; }
+    bool isConnecting() const override;
+    QString description() const override;
+
+private:
+    QTcpSocket *m_socket;
+    QString m_host;
+    quint16 m_port;
+};
+
+// QLocalSocket（Unix 域套接字/命名管道）
+class LocalSocketTransport : public IoDeviceTransport
+{
+    Q_OBJECT
+public:
+    explicit LocalSocketTransport(const QString &name, QObject *parent = nullptr);
+
+    void open() override;
+    void close() override;
+    bool isOpen() const override { return m_socket->state() == QLocalSocket::ConnectedState; }
+    bool isConnecting() const override { return m_socket->state() == QLocalSocket::ConnectingState; }
+    QString description() const override { return "local://" + m_name; }
+
+private:
+    QLocalSocket *m_socket;
+    QString m_name;
+};
+
+// 伪终端/串口设备，原始模式非阻塞读写
+class PtyTransport : public Transport
+{
+    Q_OBJECT
+public:
+    explicit PtyTransport(const QString &path, QObject *parent = nullptr);
+    ~PtyTransport();
+
+    void open() override;
+    void close() override;
+    bool isOpen() const override { return m_fd >= 0; }
+    QByteArray readAll() override;
+    qint64 readInto(QByteArray &buffer) override;
+    qint64 write(const QByteArray &data) override;
+    QString description() const override { return "pty://" + m_path; }
+
+private:
+    QString m_path;
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+};
+
+// 文件：以固定块大小和间隔回放原始字节，读完后发 disconnected()
+class FileTransport : public Transport
+{
+    Q_OBJECT
+public:
+    FileTransport(const QString &path, int chunkSize = 64, int intervalMs = 1, QObject *parent = nullptr);
+
+    void open() override;
+    void close() override;
+    bool isOpen() const override { return m_file.isOpen(); }
+    QByteArray readAll() override;
+    qint64 write(const QByteArray &data) override { return data.size(); } // 文件只读，丢弃下发的命令
+    bool reportsBytesWritten() const override { return false; }
+    QString description() const override { return "file://" + m_file.fileName(); }
+
+private:
+    QFile m_file;
+    QTimer m_timer;
+    QByteArray m_pending;
+    int m_chunkSize;
+};
+
+// 内置模拟器：按设定帧率生成 JustFloat 帧，并随机切分成不同大小的块，用于本机压测
+class SimulatorTransport : public Transport
+{
+    Q_OBJECT
+public:
+    explicit SimulatorTransport(int frameRate = 500, int channels = 1, QObject *parent = nullptr);
+
+    void open() override;
+    void close() override;
+    bool isOpen() const override { return m_timer.isActive(); }
+    QByteArray readAll() override;
+    qint64 write(const QByteArray &data) override;
+    QString description() const override { return QString("sim://?rate=%1&channels=%2").arg(m_frameRate).arg(m_channels); }
+
+private:
+    void generate();
+
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    QByteArray m_pending;
+    int m_frameRate;
+    int m_channels;
+    qint64 m_framesSent = 0;
+};
+
+#endif // TRANSPORT_H